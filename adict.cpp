@@ -12,239 +12,275 @@ You should have received a copy of the GNU General Public License along with Adi
 
 // Program includes
 #include "include/adict.h"
+#include "include/adict_reader.h"
+#include "include/docx_stream.h"
+#include "include/thread_pool.h"
+#include "include/word_sort.h"
+#include "include/stats.h"
 #include "include/global_definitions.h"
 
-// Library include
-#include "include/json.hpp"
-using json = nlohmann::json;
-
 // Standard includes
 #include <iostream>
-#include <fstream>
 #include <algorithm> // for sort and find
+#include <utility> // for move
+#include <mutex> // for call_once
+#include <memory> // for unique_ptr
+
+// Number of words built per task when compiling on several threads
+const size_t COMPILE_CHUNK_SIZE = 512;
+
+// First block of the arena of each chunk in write_docx, enough for the paragraphs of a chunk of typical words
+const size_t WRITE_ARENA_SIZE = 1 << 20;
+
+// print() writes its output once this much of it has gathered
+const size_t PRINT_BUFFER_SIZE = 1 << 16;
 
 // Methods
 
 Adict Adict::read(std::string fpath) {
-    std::ifstream f(fpath);
-    json dict_json = json::parse(f);
+    STATS_SCOPE("read");
     Adict adict;
-
-    if (dict_json.contains("meta")) {
-        for (auto& [key, value] : dict_json["meta"].items()) {
-            if (value.is_array()) {
-                // Only parse known arrays (currently only subtitles)
-                if (key == "subtitles") {
-                    for (size_t s_i = 0; s_i < value.size(); s_i++) {
-                        adict.subtitles.push_back(value[s_i]);
-                    }
-                }
-            } else {
-                adict.meta[key] = value;
-            }
-        }
-    }
-
-    if (dict_json.contains("style")) {
-        for (auto& [key, value] : dict_json["style"].items()) {
-            adict.style[key] = value;
-        }
-    }
+    AdictReader reader(adict);
 
     {
-        if (dict_json.contains("config") && dict_json["config"].contains("category_order")) {
-            adict.category_order = dict_json["config"]["category_order"].get<std::vector<std::string>>();
-            if (std::find(adict.category_order.begin(), adict.category_order.end(), "*") == adict.category_order.end()) {
-                adict.category_order.insert(adict.category_order.begin(), "*");
-            }
-        } else {
-            adict.category_order.insert(adict.category_order.begin(), "*");
-        }
+        STATS_SCOPE("read/parse");
+        reader.parse_file(fpath);
     }
 
-    for (size_t i = 0; i < dict_json["words"].size(); i++) {
-        Word word;
-
-        word.name = dict_json["words"][i]["name"];
-        word.definition = dict_json["words"][i]["definition"];
-        
-        if (dict_json["words"][i].contains("etymology")) {
-            if (dict_json["words"][i]["etymology"].is_array()) {
-                for (size_t e_i=0; e_i<dict_json["words"][i]["etymology"].size(); e_i++) {
-                    word.etymology.push_back(dict_json["words"][i]["etymology"][e_i]);
-                }
-            } else {
-                word.etymology.push_back(dict_json["words"][i]["etymology"]);
-            }
-        }
-        
-        if (dict_json["words"][i].contains("examples")) {
-            if (dict_json["words"][i]["examples"].is_array()) {
-                for (size_t e_i=0; e_i<dict_json["words"][i]["examples"].size(); e_i++) {
-                    word.examples.push_back(dict_json["words"][i]["examples"][e_i]);
-                }
-            } else {
-                word.examples.push_back(dict_json["words"][i]["examples"]);
-            }
-        }
-
-        if (dict_json["words"][i].contains("example_sentences")) {
-            if (dict_json["words"][i]["example_sentences"].is_array()) {
-                for (size_t e_i=0; e_i<dict_json["words"][i]["example_sentences"].size(); e_i++) {
-                    word.example_sentences.push_back(dict_json["words"][i]["example_sentences"][e_i]);
-                }
-            } else {
-                word.example_sentences.push_back(dict_json["words"][i]["example_sentences"]);
-            }
-        }
-
-        if (dict_json["words"][i].contains("inspirations")) {
-            if (dict_json["words"][i]["inspirations"].is_array()) {
-                for (size_t e_i=0; e_i<dict_json["words"][i]["inspirations"].size(); e_i++) {
-                    word.inspirations.push_back(dict_json["words"][i]["inspirations"][e_i]);
-                }
-            } else {
-                word.inspirations.push_back(dict_json["words"][i]["inspirations"]);
-            }
-        }
-
-        if (dict_json["words"][i].contains("notes")) {
-            if (dict_json["words"][i]["notes"].is_array()) {
-                for (size_t e_i=0; e_i<dict_json["words"][i]["notes"].size(); e_i++) {
-                    word.notes.push_back(dict_json["words"][i]["notes"][e_i]);
-                }
-            } else {
-                word.notes.push_back(dict_json["words"][i]["notes"]);
-            }
-        }
-
-        if (dict_json["words"][i].contains("category")) {
-            if (dict_json["words"][i]["category"].is_array()) {
-                std::cerr << "Error, each word can only be in one category" << newl;
-            } else {
-                adict.words_by_category[dict_json["words"][i]["category"]].push_back(word);
-            }
-            continue;
-        }
-
-        adict.words_by_category["*"].push_back(word);
-    }
+    adict.finish_reading();
     return adict;
 }
 
-void Adict::print() {
+void Adict::print(std::ostream& out) const {
+    STATS_SCOPE("print");
+
+    // The text is gathered in a buffer and written in large chunks, which is much faster than inserting
+    // every piece into the stream separately
+    std::string buf;
+    buf.reserve(PRINT_BUFFER_SIZE + PRINT_BUFFER_SIZE / 4);
+    auto flush = [&buf, &out] {
+        out.write(buf.data(), buf.size());
+        buf.clear();
+    };
+
     // Print meta
     bool meta_exists = false; // used to check if a space is necessary before the words section
-    if (meta.find("title") != meta.end()) {
-        std::cout << meta["title"] << newl;
+    auto title_it = meta.find("title");
+    if (title_it != meta.end()) {
+        buf += title_it->second;
+        buf += newl;
         meta_exists = true;
     }
 
     for (size_t s_i = 0; s_i < subtitles.size(); s_i++) {
-        std::cout << subtitles.at(s_i) << newl;
+        buf += subtitles.at(s_i);
+        buf += newl;
         meta_exists = true;
     }
 
     if (meta_exists) {
-        std::cout << newl;
+        buf += newl;
     }
 
     size_t word_count = 0;
     for (size_t i = 0; i < category_order.size(); i++) {
-        std::string category = category_order[i];
-        std::vector<Word> words = words_by_category[category];
-        word_count += words.size();
-
-        // Sort words alphabetically first
-        std::sort(words.begin(), words.end(), [](const Word& a, const Word& b) {
-            return a.name < b.name;
-        });
-
-        std::cout << newl;
-        std::cout << category << newl;
-        std::cout << "--------" << newl << newl;
-        for (size_t w_i = 0; w_i < words.size(); w_i++) {
-            Word w = words.at(w_i);
-            std::cout << "* " << w.name << ": " << w.definition << newl;
+        const std::string& category = category_order[i];
+        std::vector<uint32_t> ids = get_sorted_words(category);
+        word_count += ids.size();
+
+        buf += newl;
+        buf += category;
+        buf += newl;
+        buf += "--------" newl newl;
+        for (size_t w_i = 0; w_i < ids.size(); w_i++) {
+            WordTable::WordView w = words.get(ids[w_i]);
+            buf += "* ";
+            buf += w.name;
+            buf += ": ";
+            buf += w.definition;
+            buf += newl;
 
             if (w.etymology.size() > 0) {
-                std::cout << "+> etym.: ";
+                buf += "+> etym.: ";
                 for (size_t i=0; i<w.etymology.size(); i++) {
-                    std::cout << w.etymology.at(i);
+                    buf += w.etymology.at(i);
                     if (i != w.etymology.size()-1) {
-                        std::cout << " + ";
+                        buf += " + ";
                     }
                 }
-                std::cout << newl;
+                buf += newl;
             }
             
             if (w.examples.size() > 0) {
-                std::cout << "+> examples: ";
+                buf += "+> examples: ";
                 for (size_t i=0; i<w.examples.size(); i++) {
-                    std::cout << w.examples.at(i);
+                    buf += w.examples.at(i);
                     if (i != w.examples.size()-1) {
-                        std::cout << ", ";
+                        buf += ", ";
                     }
                 }
-                std::cout << newl;
+                buf += newl;
+            }
+
+            if (w_i < ids.size()-1) {
+                buf += newl;
             }
 
-            if (w_i < words.size()-1) {
-                std::cout << newl;
+            if (buf.size() >= PRINT_BUFFER_SIZE) {
+                flush();
             }
         }
     }
 
-    std::cout << newl << "Number of words: " << word_count << newl;
+    buf += newl "Number of words: ";
+    buf += std::to_string(word_count);
+    buf += newl;
+    flush();
+    out.flush();
 }
 
-DOCX Adict::compile() {
+DOCX Adict::compile(size_t thread_count, ParagraphCache* cache) {
+    STATS_SCOPE("compile");
     DOCX docx;
-    
-    {
-        ScriptAnalyzer::latin_typeface = "Georgia";
-        ScriptAnalyzer::japanese_typeface = "Noto Serif JP";
-        ScriptAnalyzer::arabic_typeface = "Noto Naskh Arabic";
-        ScriptAnalyzer::cyrillic_typeface = "Merriweather";
-        ScriptAnalyzer::devanagari_typeface = "Noto Serif Devanagari";
-        ScriptAnalyzer::greek_typeface = "Source Serif 4";
-        ScriptAnalyzer::set_force_use_latin_typeface_for_latin_punctuation(true);
-        docx.enable_script_analyzer();
+    Adict::configure_script_analyzer();
+    docx.enable_script_analyzer();
+
+    add_header(docx);
+    size_t category_title_size = get_category_title_size();
+
+    // Build the paragraphs of every category first (on a thread pool if asked to),
+    // then add them to the document in category order
+    WordRenderer<DOCX> renderer(field_formats, docx.get_global_font_size());
+    std::vector<std::vector<uint32_t>> category_words(category_order.size());
+    std::vector<std::vector<std::vector<DOCX::Paragraph>>> category_paragraphs(category_order.size());
+    std::vector<std::vector<uint64_t>> category_hashes(category_order.size());
+    std::vector<std::vector<const std::vector<DOCX::Paragraph>*>> category_cached(category_order.size());
+    for (size_t i = 0; i < category_order.size(); i++) {
+        category_words[i] = get_sorted_words(category_order[i]);
+        category_paragraphs[i].resize(category_words[i].size());
+        if (cache != nullptr) {
+            category_hashes[i].resize(category_words[i].size());
+            category_cached[i].resize(category_words[i].size(), nullptr);
+        }
+    }
+
+    // With a cache only the words it doesn't have yet are built
+    auto build_paragraphs = [&](size_t i, size_t begin, size_t end) {
+        STATS_SCOPE("compile/paragraphs", end - begin);
+        for (size_t w_i = begin; w_i < end; w_i++) {
+            WordTable::WordView w = words.get(category_words[i][w_i]);
+            if (cache != nullptr) {
+                category_hashes[i][w_i] = ParagraphCache::get_word_hash(w, renderer.get_format_hash());
+                category_cached[i][w_i] = cache->find(category_hashes[i][w_i]);
+                if (category_cached[i][w_i] != nullptr) {
+                    continue;
+                }
+            }
+            category_paragraphs[i][w_i] = renderer.render(w);
+        }
+    };
+
+    if (thread_count == 1) {
+        for (size_t i = 0; i < category_order.size(); i++) {
+            build_paragraphs(i, 0, category_words[i].size());
+        }
+    } else {
+        ThreadPool pool(thread_count);
+
+        // Split large categories so that one big category doesn't end up on a single thread
+        for (size_t i = 0; i < category_order.size(); i++) {
+            for (size_t begin = 0; begin < category_words[i].size(); begin += COMPILE_CHUNK_SIZE) {
+                size_t end = std::min(begin + COMPILE_CHUNK_SIZE, category_words[i].size());
+                pool.submit([&build_paragraphs, i, begin, end] { build_paragraphs(i, begin, end); });
+            }
+        }
+        pool.wait();
     }
 
+    if (cache != nullptr) {
+        cache->hits = 0;
+        cache->misses = 0;
+    }
+
+    STATS_SCOPE("compile/document");
+    for (size_t i = 0; i < category_order.size(); i++) {
+        add_category_heading(docx, category_order[i], category_title_size);
+
+        // Without a cache the paragraphs are moved into the document, they aren't needed afterwards.
+        // With one, new paragraphs are stored first and the document gets copies.
+        std::vector<std::vector<DOCX::Paragraph>>& paragraphs = category_paragraphs[i];
+        for (size_t w_i = 0; w_i < paragraphs.size(); w_i++) {
+            if (cache != nullptr) {
+                const std::vector<DOCX::Paragraph>* vp = category_cached[i][w_i];
+                if (vp != nullptr) {
+                    cache->mark_used(category_hashes[i][w_i]);
+                    cache->hits++;
+                } else {
+                    vp = cache->insert(category_hashes[i][w_i], std::move(paragraphs[w_i]));
+                    cache->misses++;
+                }
+                for (size_t p_i = 0; p_i < vp->size(); p_i++) {
+                    docx.add_paragraph(vp->at(p_i));
+                }
+            } else {
+                std::vector<DOCX::Paragraph>& vp = paragraphs[w_i];
+                for (size_t p_i = 0; p_i < vp.size(); p_i++) {
+                    docx.add_paragraph(std::move(vp[p_i]));
+                }
+                vp.clear();
+            }
+
+            if (w_i < paragraphs.size()-1) {
+                docx.add_empty_line();
+            }
+        }
+    }
+
+    if (cache != nullptr) {
+        cache->prune();
+    }
+
+    return docx;
+}
+
+template<class Document>
+void Adict::add_header(Document& docx) const {
+    using Paragraph = typename Document::Paragraph;
+    using Text = typename Document::Text;
+
     bool meta_exists = false; // used to check if a space is necessary before the words section
     if (meta.find("title") != meta.end()) {
-        DOCX::Paragraph title_p;
-        DOCX::Text title_t(meta["title"]);
+        Paragraph title_p;
+        Text title_t(meta.at("title"));
 
         if (style.find("title_size") != style.end()) {
-            title_t.size = std::stoul(style["title_size"]);
+            title_t.size = std::stoul(style.at("title_size"));
         } else {
             title_t.size = 32;
         }
 
         if (style.find("title_typeface") != style.end()) {
-            title_t.typeface = style["title_typeface"];
+            title_t.typeface = style.at("title_typeface");
         }
 
         title_p.add_text(title_t);
-        title_p.align = DOCX::Paragraph::CENTER;
+        title_p.align = Document::Paragraph::CENTER;
         docx.add_paragraph(title_p);
         meta_exists = true;
     }
 
     for (size_t s_i = 0; s_i < subtitles.size(); s_i++) {
-        DOCX::Paragraph subtitle_p;
-        DOCX::Text subtitle_t(subtitles.at(s_i));
+        Paragraph subtitle_p;
+        Text subtitle_t(subtitles.at(s_i));
 
         if (style.find("subtitle_size") != style.end()) {
-            subtitle_t.size = std::stoul(style["subtitle_size"]);
+            subtitle_t.size = std::stoul(style.at("subtitle_size"));
         } else {
             subtitle_t.size = 10;
         }
 
         subtitle_p.add_text(subtitle_t);
-        subtitle_p.align = DOCX::Paragraph::CENTER;
+        subtitle_p.align = Document::Paragraph::CENTER;
         docx.add_paragraph(subtitle_p);
         meta_exists = true;
     }
@@ -252,228 +288,172 @@ DOCX Adict::compile() {
     if (meta_exists) {
         docx.add_empty_line(1);
     }
+}
 
-    for (int i = 0; i < category_order.size(); i++) {
-        std::string category = category_order[i];
-        std::vector<Word> words = words_by_category[category];
-
-        // Sort words alphabetically first
-        std::sort(words.begin(), words.end(), [](const Word& a, const Word& b) {
-            return a.name < b.name;
-        });
-
-        docx.add_empty_line();
-
-        // check if custom title size is set for sections (categories)
-        size_t category_title_size = 14;
-        if (style.find("section_title_size") != style.end()) {
-            category_title_size = std::stoul(style["section_title_size"]);
-        }
-
-        if (category != "*") {
-            DOCX::Paragraph category_title_p;
-            DOCX::Text category_title_t(category);
-            category_title_t.size = category_title_size;
-            category_title_t.bold = true;
-            category_title_p.add_text(category_title_t);
-            docx.add_paragraph(category_title_p);
-            docx.add_empty_line();
-        }
-
-        for (size_t w_i = 0; w_i < words.size(); w_i++) {
-            Word w = words.at(w_i);
-            std::vector<DOCX::Paragraph> vp = Adict::get_vector_of_paragraphs_from_word(w, docx);
-            for (size_t p_i = 0; p_i < vp.size(); p_i++) {
-                DOCX::Paragraph p = vp.at(p_i);
-                docx.add_paragraph(p);
-            }
-            if (w_i < words.size()-1) {
-                docx.add_empty_line();
-            }
-        }
+size_t Adict::get_category_title_size() const {
+    // check if custom title size is set for sections (categories)
+    size_t category_title_size = 14;
+    if (style.find("section_title_size") != style.end()) {
+        category_title_size = std::stoul(style.at("section_title_size"));
     }
-
-    return docx;
+    return category_title_size;
 }
 
-std::vector<DOCX::Paragraph> Adict::get_vector_of_paragraphs_from_word(Word cur_word, DOCX& docx) {
-    std::vector<DOCX::Paragraph> vp;
+template<class Document>
+void Adict::add_category_heading(Document& docx, const std::string& category, size_t category_title_size) {
+    using Paragraph = typename Document::Paragraph;
+    using Text = typename Document::Text;
 
-    // Fist line (name and definition)
-    DOCX::Paragraph p;
+    docx.add_empty_line();
 
-    p.add_bold_text(cur_word.name);
-    p.add_bold_text(":");
-    p.add_space();
-    p.add_plain_text(cur_word.definition);
-
-    vp.push_back(p);
-
-    size_t global_font_size = docx.get_global_font_size();
-    size_t subsize = global_font_size - 1;
-    if (global_font_size <= 1) {
-        subsize = 1;
+    if (category != "*") {
+        Paragraph category_title_p;
+        Text category_title_t(category);
+        category_title_t.size = category_title_size;
+        category_title_t.bold = true;
+        category_title_p.add_text(category_title_t);
+        docx.add_paragraph(category_title_p);
+        docx.add_empty_line();
     }
+}
 
-    // Second line (etymology)
-    if (!cur_word.etymology.empty()) {
-        DOCX::Paragraph p2;
-
-        DOCX::Text etym_label("etym.");
-        etym_label.size = subsize;
-        etym_label.italic = true;
-        p2.add_text(etym_label);
-
-        DOCX::Text etym_colon(":");
-        etym_colon.size = subsize;
-        p2.add_text(etym_colon);
-
-        p2.add_space(1, subsize);
-
-        for (size_t e_i = 0; e_i < cur_word.etymology.size(); e_i++) {
-            DOCX::Text etym_content(cur_word.etymology.at(e_i));
-            etym_content.size = subsize;
-            p2.add_text(etym_content);
-
-            if (e_i < cur_word.etymology.size()-1) {
-                DOCX::Text comma(",");
-                comma.size = subsize;
-                p2.add_text(comma);
-                p2.add_space(1, subsize);
-            }
-        }
-
-        vp.push_back(p2);
+void Adict::write_docx(std::string fpath, size_t thread_count) const {
+    STATS_SCOPE("write_docx");
+    Adict::configure_script_analyzer();
+    DocxStream out(fpath, DOCX().get_global_font_size());
+    WordRenderer<DocxStream> renderer(field_formats, out.get_global_font_size());
+
+    add_header(out);
+    size_t category_title_size = get_category_title_size();
+
+    // Words are built a window at a time (one chunk per thread) and written before the next window is started
+    std::unique_ptr<ThreadPool> pool;
+    size_t window = COMPILE_CHUNK_SIZE;
+    if (thread_count != 1) {
+        pool = std::make_unique<ThreadPool>(thread_count);
+        window = COMPILE_CHUNK_SIZE * pool->size();
     }
 
-    // Third line (examples)
-    if (!cur_word.examples.empty()) {
-        DOCX::Paragraph p3;
+    // The paragraphs of each chunk are built in an arena of their own, emptied once the window is written.
+    // Declared before paragraphs so that the paragraphs are gone before the arenas are.
+    std::vector<std::unique_ptr<DocxStream::Arena>> arenas;
+    for (size_t c_i = 0; c_i < window / COMPILE_CHUNK_SIZE; c_i++) {
+        arenas.push_back(std::make_unique<DocxStream::Arena>(WRITE_ARENA_SIZE));
+    }
 
-        DOCX::Text exs_label("ex.");
-        exs_label.size = subsize;
-        exs_label.italic = true;
-        p3.add_text(exs_label);
+    std::vector<std::vector<DocxStream::Paragraph>> paragraphs;
+    for (size_t i = 0; i < category_order.size(); i++) {
+        add_category_heading(out, category_order[i], category_title_size);
+
+        std::vector<uint32_t> ids = get_sorted_words(category_order[i]);
+        for (size_t window_begin = 0; window_begin < ids.size(); window_begin += window) {
+            size_t window_end = std::min(window_begin + window, ids.size());
+            paragraphs.assign(window_end - window_begin, {});
+
+            auto build_paragraphs = [&](size_t begin, size_t end) {
+                STATS_SCOPE("compile/paragraphs", end - begin);
+                DocxStream::Arena::Use use(*arenas[(begin - window_begin) / COMPILE_CHUNK_SIZE]);
+                for (size_t w_i = begin; w_i < end; w_i++) {
+                    paragraphs[w_i - window_begin] = renderer.render(words.get(ids[w_i]));
+                }
+            };
 
-        DOCX::Text exs_colon(":");
-        exs_colon.size = subsize;
-        p3.add_text(exs_colon);
+            if (pool == nullptr) {
+                build_paragraphs(window_begin, window_end);
+            } else {
+                for (size_t begin = window_begin; begin < window_end; begin += COMPILE_CHUNK_SIZE) {
+                    size_t end = std::min(begin + COMPILE_CHUNK_SIZE, window_end);
+                    pool->submit([&build_paragraphs, begin, end] { build_paragraphs(begin, end); });
+                }
+                pool->wait();
+            }
 
-        p3.add_space(1, subsize);
+            STATS_SCOPE("write_docx/document");
+            for (size_t w_i = window_begin; w_i < window_end; w_i++) {
+                for (const DocxStream::Paragraph& p : paragraphs[w_i - window_begin]) {
+                    out.add_paragraph(p);
+                }
 
-        for (size_t e_i = 0; e_i < cur_word.examples.size(); e_i++) {
-            DOCX::Text exs_content(cur_word.examples.at(e_i));
-            exs_content.size = subsize;
-            p3.add_text(exs_content);
+                if (w_i < ids.size()-1) {
+                    out.add_empty_line();
+                }
+            }
 
-            if (e_i < cur_word.examples.size()-1) {
-                DOCX::Text comma(",");
-                comma.size = subsize;
-                p3.add_text(comma);
-                p3.add_space(1, subsize);
+            paragraphs.clear();
+            for (std::unique_ptr<DocxStream::Arena>& arena : arenas) {
+                arena->release();
             }
         }
-
-        vp.push_back(p3);
     }
 
-    // Fourth line (example sentences)
-    if (!cur_word.example_sentences.empty()) {
-        DOCX::Paragraph p3;
-
-        DOCX::Text exs_label("ex.s.");
-        exs_label.size = subsize;
-        exs_label.italic = true;
-        p3.add_text(exs_label);
-
-        DOCX::Text exs_colon(":");
-        exs_colon.size = subsize;
-        p3.add_text(exs_colon);
-
-        p3.add_space(1, subsize);
-
-        for (size_t e_i = 0; e_i < cur_word.example_sentences.size(); e_i++) {
-            DOCX::Text quote("\"");
-            quote.size = subsize;
-            p3.add_text(quote);
+    out.close();
+}
 
-            DOCX::Text exs_content(cur_word.example_sentences.at(e_i));
-            exs_content.size = subsize;
-            p3.add_text(exs_content);
+std::atomic<bool> Adict::copy_sources{false};
 
-            p3.add_text(quote);
+void Adict::set_copy_sources(bool copy) {
+    copy_sources.store(copy);
+}
 
-            if (e_i < cur_word.example_sentences.size()-1) {
-                DOCX::Text comma(",");
-                comma.size = subsize;
-                p3.add_text(comma);
-                p3.add_space(1, subsize);
-            }
-        }
+void Adict::configure_script_analyzer() {
+    // The typefaces are global, set them once per process rather than on every compile
+    static std::once_flag configured;
+    std::call_once(configured, [] {
+        ScriptAnalyzer::latin_typeface = "Georgia";
+        ScriptAnalyzer::japanese_typeface = "Noto Serif JP";
+        ScriptAnalyzer::arabic_typeface = "Noto Naskh Arabic";
+        ScriptAnalyzer::cyrillic_typeface = "Merriweather";
+        ScriptAnalyzer::devanagari_typeface = "Noto Serif Devanagari";
+        ScriptAnalyzer::greek_typeface = "Source Serif 4";
+        ScriptAnalyzer::set_force_use_latin_typeface_for_latin_punctuation(true);
+    });
+}
 
-        vp.push_back(p3);
+void Adict::finish_reading() {
+    if (std::find(category_order.begin(), category_order.end(), "*") == category_order.end()) {
+        category_order.insert(category_order.begin(), "*");
     }
 
-    // Fifth line (inspirations)
-    if (!cur_word.inspirations.empty()) {
-        DOCX::Paragraph p3;
-
-        DOCX::Text insp_label("inspirations");
-        insp_label.size = subsize;
-        insp_label.italic = true;
-        p3.add_text(insp_label);
-
-        DOCX::Text insp_colon(":");
-        insp_colon.size = subsize;
-        p3.add_text(insp_colon);
+    build_sorted_index();
+}
 
-        p3.add_space(1, subsize);
+void Adict::build_sorted_index() {
+    Collation::Mode mode = Collation::ROOT;
+    if (!Collation::get_mode(collation, mode)) {
+        std::cerr << "Unknown collation \"" << collation << "\", using root" << newl;
+    }
 
-        for (size_t i_i = 0; i_i < cur_word.inspirations.size(); i_i++) {
-            DOCX::Text insp_content(cur_word.inspirations.at(i_i));
-            insp_content.size = subsize;
-            p3.add_text(insp_content);
+    STATS_SCOPE("sort", words.size());
+    build_sort_keys(words, mode);
 
-            if (i_i < cur_word.inspirations.size()-1) {
-                DOCX::Text comma(",");
-                comma.size = subsize;
-                p3.add_text(comma);
-                p3.add_space(1, subsize);
-            }
+    sorted_index.clear();
+    std::vector<std::string_view> keys;
+    for (const auto& [category, ids] : words_by_category) {
+        keys.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            keys[i] = words.get_sort_key(ids[i]);
         }
-
-        vp.push_back(p3);
+        sorted_index[category] = sort_word_indices(keys);
     }
+}
 
-    // Sixth line onwards (notes)
-    if (!cur_word.notes.empty()) {
-        DOCX::Paragraph p3;
-
-        DOCX::Text notes_label("notes");
-        notes_label.size = subsize;
-        notes_label.italic = true;
-        p3.add_text(notes_label);
-
-        DOCX::Text notes_colon(":");
-        notes_colon.size = subsize;
-        p3.add_text(notes_colon);
-
-        p3.add_space(1, subsize);
-
-        for (size_t n_i = 0; n_i < cur_word.notes.size(); n_i++) {
-            DOCX::Text notes_content(cur_word.notes.at(n_i));
-            notes_content.size = subsize;
-            p3.add_text(notes_content);
-
-            if (n_i < cur_word.notes.size()-1) {
-                DOCX::Text comma(",");
-                comma.size = subsize;
-                p3.add_text(comma);
-                p3.add_space(1, subsize);
-            }
-        }
+std::vector<uint32_t> Adict::get_sorted_words(const std::string& category) const {
+    std::vector<uint32_t> sorted;
+    auto ids_it = words_by_category.find(category);
+    auto index_it = sorted_index.find(category);
+    if ((ids_it == words_by_category.end()) || (index_it == sorted_index.end())) {
+        return sorted;
+    }
 
-        vp.push_back(p3);
+    sorted.reserve(index_it->second.size());
+    for (size_t i : index_it->second) {
+        sorted.push_back(ids_it->second[i]);
     }
-    return vp;
-}
\ No newline at end of file
+    return sorted;
+}
+
+// The builders are used with both kinds of document
+template void Adict::add_header<DOCX>(DOCX& docx) const;
+template void Adict::add_header<DocxStream>(DocxStream& docx) const;
+template void Adict::add_category_heading<DOCX>(DOCX& docx, const std::string& category, size_t category_title_size);
+template void Adict::add_category_heading<DocxStream>(DocxStream& docx, const std::string& category, size_t category_title_size);
@@ -0,0 +1,536 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Binary cache (.adictbin) layout, all integers in native byte order:
+
+    CacheHeader
+    uint32_t records[record_count]        structure of the Adict, strings are referenced by id
+    uint32_t string_offsets[string_count+1]  string i is blob[offsets[i], offsets[i+1])
+    char blob[blob_size]
+
+records:
+    n, n * (key, value)                   meta
+    n, n * (key, value)                   style
+    n, n * id                             subtitles
+    n, n * id                             category_order
+    id                                    collation
+    n, n * (key, label, separator, quote) field_formats
+    n, n * category                       words_by_category
+        category: name, word count, word count * word
+        word: name, definition, then 5 * (n, n * id) for etymology, examples,
+              example_sentences, inspirations and notes, then n, n * (key, m, m * id) for the extra fields
+*/
+
+// Program includes
+#include "include/adict.h"
+#include "include/mapped_file.h"
+#include "include/hash.h"
+#include "include/stats.h"
+#include "include/global_definitions.h"
+
+// System includes
+#include <sys/stat.h>
+#include <fcntl.h> // for open
+#include <unistd.h> // for pread, pwrite and close
+#include <time.h> // for clock_gettime
+
+// Standard includes
+#include <iostream>
+#include <fstream>
+#include <cstring> // for memcmp and memcpy
+#include <cstdint>
+#include <cstdio> // for rename and remove
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'A', 'D', 'I', 'C', 'T', 'B', 'I', 'N'};
+const uint32_t CACHE_VERSION = 5;
+const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime; // nanoseconds
+    uint64_t source_hash;
+    uint64_t record_count;
+    uint64_t string_count;
+    uint64_t blob_size;
+};
+
+bool stat_source(const std::string& fpath, uint64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (stat(fpath.c_str(), &st) != 0) {
+        return false;
+    }
+    size = st.st_size;
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+// How long after a write its mtime may still be shared by another write. Files with whole second mtimes are on
+// file systems with coarse timestamps (FAT has 2 s), the others get the kernel's clock tick with a margin.
+int64_t get_racy_window(int64_t mtime) {
+    return (mtime % 1000000000 == 0) ? 2000000000 : 100000000;
+}
+
+bool is_mtime_racy(int64_t mtime) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t now_ns = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    return mtime > now_ns - get_racy_window(mtime);
+}
+
+// The headers of the cache, the index and the trie all start with the magic, the version and the byte order, then the
+// source size, mtime and hash
+const off_t SOURCE_KEY_OFFSET = 16;
+
+// Replaces the source mtime in the header of keyed_path, if that file is still keyed with the given size and hash.
+// Failing to (read only file...) only means the content is hashed again next time.
+void update_source_mtime(const std::string& keyed_path, uint64_t size, uint64_t hash, int64_t mtime) {
+    int fd = open(keyed_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    uint64_t stored[3]; // size, mtime, hash
+    if ((pread(fd, stored, sizeof(stored), SOURCE_KEY_OFFSET) == sizeof(stored)) && (stored[0] == size) && (stored[2] == hash)) {
+        pwrite(fd, &mtime, sizeof(mtime), SOURCE_KEY_OFFSET + sizeof(uint64_t));
+    }
+    close(fd);
+}
+
+// Collects records and deduplicated strings while an Adict is being written
+class CacheWriter {
+public:
+    std::vector<uint32_t> records;
+    std::vector<uint32_t> offsets{0};
+    std::string blob;
+
+    void add(uint32_t v) {
+        records.push_back(v);
+    }
+
+    void add_string(std::string_view s) {
+        auto it = ids.find(s);
+        if (it != ids.end()) {
+            records.push_back(it->second);
+            return;
+        }
+
+        uint32_t id = offsets.size() - 1;
+        blob += s;
+        offsets.push_back(blob.size());
+        // Keys point into the Adict being written, which outlives the writer
+        ids.emplace(s, id);
+        records.push_back(id);
+    }
+
+    void add_list(const std::vector<std::string>& v) {
+        add(v.size());
+        for (const std::string& s : v) {
+            add_string(s);
+        }
+    }
+
+    void add_list(const WordTable::List& v) {
+        add(v.size());
+        for (size_t i = 0; i < v.size(); i++) {
+            add_string(v[i]);
+        }
+    }
+
+    void add_map(const std::map<std::string, std::string>& m) {
+        add(m.size());
+        for (const auto& [key, value] : m) {
+            add_string(key);
+            add_string(value);
+        }
+    }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+// Bounds checked reader over a mapped cache file
+class CacheReader {
+public:
+    CacheReader(const uint32_t* records, size_t record_count, const uint32_t* offsets, size_t string_count, const char* blob, size_t blob_size) :
+        records(records), record_count(record_count), offsets(offsets), string_count(string_count), blob(blob), blob_size(blob_size) {}
+
+    bool next(uint32_t& v) {
+        if (pos >= record_count) {
+            return false;
+        }
+        std::memcpy(&v, records + pos, sizeof(uint32_t));
+        pos++;
+        return true;
+    }
+
+    // The string as an (offset, size) reference into the blob
+    bool next_ref(WordTable::StringRef& ref) {
+        uint32_t id;
+        if (!next(id) || (id >= string_count)) {
+            return false;
+        }
+
+        uint32_t begin;
+        uint32_t end;
+        std::memcpy(&begin, offsets + id, sizeof(uint32_t));
+        std::memcpy(&end, offsets + id + 1, sizeof(uint32_t));
+        if ((begin > end) || (end > blob_size)) {
+            return false;
+        }
+        ref.offset = begin;
+        ref.size = end - begin;
+        return true;
+    }
+
+    bool next_string(std::string& s) {
+        WordTable::StringRef ref;
+        if (!next_ref(ref)) {
+            return false;
+        }
+        s.assign(blob + ref.offset, ref.size);
+        return true;
+    }
+
+    // Appends the references of a list to v
+    bool next_ref_list(std::vector<WordTable::StringRef>& v) {
+        uint32_t n;
+        if (!next(n) || (n > record_count - pos)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            WordTable::StringRef ref;
+            if (!next_ref(ref)) {
+                return false;
+            }
+            v.push_back(ref);
+        }
+        return true;
+    }
+
+    bool next_word(WordTable::WordRefs& w) {
+        if (!next_ref(w.name) || !next_ref(w.definition)) {
+            return false;
+        }
+        w.entries.clear();
+        for (uint32_t& end : w.list_ends) {
+            if (!next_ref_list(w.entries)) {
+                return false;
+            }
+            end = w.entries.size();
+        }
+
+        uint32_t n;
+        if (!next(n) || (n > record_count - pos)) {
+            return false;
+        }
+        w.extra_fields.resize(n);
+        for (WordTable::ExtraRange& f : w.extra_fields) {
+            f.begin = w.entries.size();
+            if (!next_ref(f.key) || !next_ref_list(w.entries)) {
+                return false;
+            }
+            f.end = w.entries.size();
+        }
+        return true;
+    }
+
+    bool next_list(std::vector<std::string>& v) {
+        uint32_t n;
+        if (!next(n) || (n > record_count - pos)) {
+            return false;
+        }
+        v.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            if (!next_string(v[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool next_map(std::map<std::string, std::string>& m) {
+        uint32_t n;
+        if (!next(n)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            std::string key;
+            std::string value;
+            if (!next_string(key) || !next_string(value)) {
+                return false;
+            }
+            m[key] = std::move(value);
+        }
+        return true;
+    }
+
+    bool at_end() {
+        return pos == record_count;
+    }
+
+private:
+    const uint32_t* records;
+    size_t record_count;
+    const uint32_t* offsets;
+    size_t string_count;
+    const char* blob;
+    size_t blob_size;
+    size_t pos = 0;
+};
+
+} // namespace
+
+// Methods
+
+Adict Adict::load(std::string fpath) {
+    Adict adict;
+    if (read_cache(fpath, adict)) {
+        return adict;
+    }
+
+    // Key the cache before parsing so that an edit made during the parse leaves it stale
+    CacheKey key;
+    bool key_ok = get_cache_key(fpath, key);
+    adict = Adict::read(fpath);
+    if (key_ok) {
+        adict.write_cache(fpath, key);
+    }
+    return adict;
+}
+
+bool Adict::get_cache_key(std::string fpath, CacheKey& key) {
+    if (!stat_source(fpath, key.size, key.mtime)) {
+        return false;
+    }
+
+    // A file written again within one timestamp tick keeps its mtime, so the mtime of a file modified just before it
+    // is keyed can't tell a later edit apart. Such keys leave it out and are checked by content.
+    if (is_mtime_racy(key.mtime)) {
+        key.mtime = 0;
+    }
+
+    MappedFile mf(fpath, copy_sources.load());
+    if (!mf.is_open()) {
+        return false;
+    }
+    key.hash = hash_content(mf.data(), mf.size());
+    return true;
+}
+
+bool Adict::is_source_unchanged(std::string fpath, const CacheKey& key, const std::string& keyed_path) {
+    uint64_t size;
+    int64_t mtime;
+    if (!stat_source(fpath, size, mtime) || (key.size != size)) {
+        return false;
+    }
+    if ((key.mtime != 0) && (key.mtime == mtime)) {
+        return true;
+    }
+
+    // Touched, copied or keyed too soon after an edit, the content decides
+    CacheKey current;
+    if (!get_cache_key(fpath, current) || (current.hash != key.hash)) {
+        return false;
+    }
+    if ((current.mtime != 0) && (current.mtime == mtime)) {
+        update_source_mtime(keyed_path, key.size, key.hash, mtime); // so that the next check doesn't hash
+    }
+    return true;
+}
+
+std::string Adict::get_cache_path(std::string fpath) {
+    return get_derived_path(fpath, ".adictbin");
+}
+
+std::string Adict::get_derived_path(const std::string& fpath, const std::string& extension) {
+    if (fpath.size() > 5) { // dot and 'json'
+        std::string sub = fpath.substr(fpath.size() - 5, 5);
+        if ((sub == ".json") || (sub == ".JSON")) {
+            return fpath.substr(0, fpath.size() - 5) + extension;
+        }
+    }
+    return fpath + extension;
+}
+
+void Adict::write_derived_file(const std::string& path, std::initializer_list<std::string_view> parts, const char* kind) {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        for (std::string_view part : parts) {
+            f.write(part.data(), part.size());
+        }
+        if (!f) {
+            std::cerr << "Could not write " << kind << " file: " << tmp_path << newl;
+            f.close();
+            std::remove(tmp_path.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+    }
+}
+
+bool Adict::read_cache(std::string fpath, Adict& adict) {
+    STATS_SCOPE("load/cache");
+    std::shared_ptr<MappedFile> mf = std::make_shared<MappedFile>(Adict::get_cache_path(fpath), copy_sources.load());
+    if (!mf->is_open() || (mf->size() < sizeof(CacheHeader))) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, mf->data(), sizeof(CacheHeader));
+    if ((std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) || (header.version != CACHE_VERSION) || (header.byte_order != CACHE_BYTE_ORDER)) {
+        return false;
+    }
+
+    CacheKey source;
+    source.size = header.source_size;
+    source.mtime = header.source_mtime;
+    source.hash = header.source_hash;
+    if (!is_source_unchanged(fpath, source, Adict::get_cache_path(fpath))) {
+        return false;
+    }
+
+    uint64_t body_size = mf->size() - sizeof(CacheHeader);
+    if ((header.record_count > body_size / 4) || (header.string_count >= body_size / 4) || (header.blob_size > body_size) ||
+        ((header.record_count + header.string_count + 1) * 4 + header.blob_size != body_size)) {
+        return false;
+    }
+
+    const char* body = mf->data() + sizeof(CacheHeader);
+    const uint32_t* records = reinterpret_cast<const uint32_t*>(body);
+    const uint32_t* offsets = records + header.record_count;
+    const char* blob = reinterpret_cast<const char*>(offsets + header.string_count + 1);
+    CacheReader r(records, header.record_count, offsets, header.string_count, blob, header.blob_size);
+
+    Adict result;
+    if (!r.next_map(result.meta) || !r.next_map(result.style) || !r.next_list(result.subtitles) || !r.next_list(result.category_order) || !r.next_string(result.collation)) {
+        return false;
+    }
+
+    uint32_t format_count;
+    if (!r.next(format_count)) {
+        return false;
+    }
+    for (uint32_t f_i = 0; f_i < format_count; f_i++) {
+        FieldFormat f;
+        if (!r.next_string(f.key) || !r.next_string(f.label) || !r.next_string(f.separator) || !r.next_string(f.quote)) {
+            return false;
+        }
+        result.field_formats.push_back(std::move(f));
+    }
+
+    uint32_t category_count;
+    if (!r.next(category_count)) {
+        return false;
+    }
+    // The words' strings stay in the blob, which the table keeps mapped
+    WordTable::WordRefs w; // reused for every word
+    result.words.use_pool(mf, std::string_view(blob, header.blob_size));
+    for (uint32_t c_i = 0; c_i < category_count; c_i++) {
+        std::string category;
+        uint32_t word_count;
+        if (!r.next_string(category) || !r.next(word_count)) {
+            return false;
+        }
+
+        std::vector<uint32_t>& ids = result.words_by_category[category];
+        ids.reserve(word_count);
+        for (uint32_t w_i = 0; w_i < word_count; w_i++) {
+            if (!r.next_word(w)) {
+                return false;
+            }
+            ids.push_back(result.words.add(w));
+        }
+    }
+
+    if (!r.at_end()) {
+        return false;
+    }
+
+    result.build_sorted_index();
+    adict = std::move(result);
+    return true;
+}
+
+void Adict::write_cache(std::string fpath, const CacheKey& key) {
+    CacheWriter w;
+    w.add_map(meta);
+    w.add_map(style);
+    w.add_list(subtitles);
+    w.add_list(category_order);
+    w.add_string(collation);
+
+    w.add(field_formats.size());
+    for (const FieldFormat& f : field_formats) {
+        w.add_string(f.key);
+        w.add_string(f.label);
+        w.add_string(f.separator);
+        w.add_string(f.quote);
+    }
+
+    w.add(words_by_category.size());
+    for (const auto& [category, ids] : words_by_category) {
+        w.add_string(category);
+        w.add(ids.size());
+        for (uint32_t id : ids) {
+            WordTable::WordView word = words.get(id);
+            w.add_string(word.name);
+            w.add_string(word.definition);
+            w.add_list(word.etymology);
+            w.add_list(word.examples);
+            w.add_list(word.example_sentences);
+            w.add_list(word.inspirations);
+            w.add_list(word.notes);
+
+            w.add(word.extra_fields.size());
+            for (size_t f_i = 0; f_i < word.extra_fields.size(); f_i++) {
+                w.add_string(word.extra_fields.get_key(f_i));
+                w.add_list(word.extra_fields.get(f_i));
+            }
+        }
+    }
+
+    // Offsets are 32 bits wide
+    if (w.blob.size() > UINT32_MAX) {
+        return;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.source_size = key.size;
+    header.source_mtime = key.mtime;
+    header.source_hash = key.hash;
+    header.record_count = w.records.size();
+    header.string_count = w.offsets.size() - 1;
+    header.blob_size = w.blob.size();
+
+    write_derived_file(get_cache_path(fpath), {
+        std::string_view(reinterpret_cast<const char*>(&header), sizeof(CacheHeader)),
+        std::string_view(reinterpret_cast<const char*>(w.records.data()), w.records.size() * sizeof(uint32_t)),
+        std::string_view(reinterpret_cast<const char*>(w.offsets.data()), w.offsets.size() * sizeof(uint32_t)),
+        w.blob
+    }, "cache");
+}
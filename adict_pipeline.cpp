@@ -0,0 +1,228 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Pipelined read and compile:
+
+    parser (calling thread) --parsed--> paragraph builders (thread_count) --built--> collector
+
+The parser hands words over in batches as the SAX reader finishes them. Builders turn each word into its paragraphs,
+which don't depend on the word's place in the document, and the collector files words and paragraphs under their
+category at their input position. Both queues are bounded, so the parser waits if the builders fall behind.
+
+Words can only be put in order once the last of them is read, so the document is assembled after parsing ends,
+from paragraphs that are already built. Builders use the field formats known when the first word is read. config
+normally comes before the words; a dictionary with config.fields after them gets its paragraphs rebuilt once parsing
+ends.
+*/
+
+// Program includes
+#include "include/adict.h"
+#include "include/adict_reader.h"
+#include "include/bounded_queue.h"
+#include "include/thread_pool.h"
+#include "include/stats.h"
+
+// Standard includes
+#include <algorithm> // for min
+#include <atomic>
+#include <exception>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <utility> // for move
+
+// Words per batch handed between the stages, so that the queues aren't locked once per word
+const size_t PIPELINE_BATCH_SIZE = 256;
+
+// Batches each queue holds at most
+const size_t PIPELINE_QUEUE_SIZE = 16;
+
+namespace {
+
+struct Batch {
+    std::vector<std::string> categories;
+    std::vector<size_t> positions; // of each word within its category, in input order
+    WordTable words;
+    std::vector<std::vector<DOCX::Paragraph>> paragraphs;
+};
+
+} // namespace
+
+DOCX Adict::read_and_compile(std::string fpath, size_t thread_count) {
+    STATS_SCOPE("read_and_compile");
+    if (thread_count == 0) {
+        thread_count = ThreadPool::get_default_thread_count();
+    }
+
+    DOCX docx;
+    Adict::configure_script_analyzer();
+    docx.enable_script_analyzer();
+    // Made by the parser before it sends the first batch, see the word handler
+    std::unique_ptr<WordRenderer<DOCX>> renderer;
+    std::vector<FieldFormat> rendered_formats;
+
+    BoundedQueue<Batch> parsed(PIPELINE_QUEUE_SIZE);
+    BoundedQueue<Batch> built(PIPELINE_QUEUE_SIZE);
+    std::map<std::string, std::vector<std::vector<DOCX::Paragraph>>> paragraphs_by_category;
+
+    // The last builder to stop closes the queue after it
+    std::atomic<size_t> builders_left{thread_count};
+    auto stop_builder = [&builders_left, &built] {
+        if (builders_left.fetch_sub(1) == 1) {
+            built.close();
+        }
+    };
+
+    auto build = [&] {
+        try {
+            Batch b;
+            while (parsed.pop(b)) {
+                STATS_SCOPE("compile/paragraphs", b.words.size());
+                b.paragraphs.resize(b.words.size());
+                for (size_t w_i = 0; w_i < b.words.size(); w_i++) {
+                    b.paragraphs[w_i] = renderer->render(b.words.get(w_i));
+                }
+                built.push(std::move(b));
+            }
+        } catch (...) {
+            parsed.close(); // stops the parser
+            stop_builder();
+            throw;
+        }
+        stop_builder();
+    };
+
+    // Only the collector touches words and words_by_category until the pool is done, the parser fills the other members.
+    // Batches can arrive out of order, so ids follow arrival and positions keep the input order.
+    auto collect = [&] {
+        try {
+            Batch b;
+            while (built.pop(b)) {
+                for (size_t w_i = 0; w_i < b.words.size(); w_i++) {
+                    std::vector<uint32_t>& ids = words_by_category[b.categories[w_i]];
+                    std::vector<std::vector<DOCX::Paragraph>>& paragraphs = paragraphs_by_category[b.categories[w_i]];
+                    size_t pos = b.positions[w_i];
+                    if (ids.size() <= pos) {
+                        ids.resize(pos + 1);
+                        paragraphs.resize(pos + 1);
+                    }
+                    ids[pos] = words.add(b.words.get(w_i));
+                    paragraphs[pos] = std::move(b.paragraphs[w_i]);
+                }
+            }
+        } catch (...) {
+            // Stops the builders and through them the parser, the error is rethrown by pool.wait
+            built.close();
+            parsed.close();
+            throw;
+        }
+    };
+
+    ThreadPool pool(thread_count + 1);
+    for (size_t t = 0; t < thread_count; t++) {
+        pool.submit(build);
+    }
+    pool.submit(collect);
+
+    Batch pending;
+    std::map<std::string, size_t> category_sizes;
+    auto send = [&pending, &parsed] {
+        if (!parsed.push(std::move(pending))) {
+            throw std::runtime_error("paragraph building stopped");
+        }
+        pending = Batch();
+    };
+
+    AdictReader reader(*this);
+    reader.set_word_handler([&](const std::string& category, const Word& w) {
+        if (!renderer) {
+            rendered_formats = field_formats;
+            renderer = std::make_unique<WordRenderer<DOCX>>(rendered_formats, docx.get_global_font_size());
+        }
+        pending.categories.push_back(category);
+        pending.positions.push_back(category_sizes[category]++);
+        pending.words.add(w);
+        if (pending.words.size() >= PIPELINE_BATCH_SIZE) {
+            send();
+        }
+    });
+
+    std::exception_ptr parse_error;
+    try {
+        STATS_SCOPE("read/parse");
+        reader.parse_file(fpath);
+        if (pending.words.size() > 0) {
+            send();
+        }
+    } catch (...) {
+        parse_error = std::current_exception();
+    }
+    parsed.close();
+
+    pool.wait(); // a failure of the other stages is rethrown first, it is what stopped the parser
+    if (parse_error) {
+        std::rethrow_exception(parse_error);
+    }
+
+    finish_reading();
+
+    if (field_formats != rendered_formats) { // config.fields came after the words
+        WordRenderer<DOCX> configured_renderer(field_formats, docx.get_global_font_size());
+        for (auto& entry : paragraphs_by_category) {
+            std::vector<std::vector<DOCX::Paragraph>>& paragraphs = entry.second;
+            const std::vector<uint32_t>& ids = words_by_category[entry.first];
+            for (size_t begin = 0; begin < ids.size(); begin += PIPELINE_BATCH_SIZE) {
+                size_t end = std::min(begin + PIPELINE_BATCH_SIZE, ids.size());
+                pool.submit([this, &configured_renderer, &paragraphs, &ids, begin, end] {
+                    STATS_SCOPE("compile/paragraphs", end - begin);
+                    for (size_t w_i = begin; w_i < end; w_i++) {
+                        paragraphs[w_i] = configured_renderer.render(words.get(ids[w_i]));
+                    }
+                });
+            }
+        }
+        pool.wait();
+    }
+
+    // Same layout as compile()
+    add_header(docx);
+    size_t category_title_size = get_category_title_size();
+
+    STATS_SCOPE("compile/document");
+    for (size_t i = 0; i < category_order.size(); i++) {
+        const std::string& category = category_order[i];
+        add_category_heading(docx, category, category_title_size);
+
+        auto index_it = sorted_index.find(category);
+        if (index_it == sorted_index.end()) {
+            continue;
+        }
+
+        const std::vector<size_t>& order = index_it->second;
+        std::vector<std::vector<DOCX::Paragraph>>& paragraphs = paragraphs_by_category[category];
+        for (size_t o_i = 0; o_i < order.size(); o_i++) {
+            std::vector<DOCX::Paragraph>& vp = paragraphs[order[o_i]];
+            for (size_t p_i = 0; p_i < vp.size(); p_i++) {
+                docx.add_paragraph(std::move(vp[p_i]));
+            }
+            vp.clear();
+
+            if (o_i < order.size()-1) {
+                docx.add_empty_line();
+            }
+        }
+        std::vector<std::vector<DOCX::Paragraph>>().swap(paragraphs); // moved into docx, only the husks are left
+    }
+
+    return docx;
+}
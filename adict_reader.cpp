@@ -0,0 +1,411 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/adict_reader.h"
+#include "include/mapped_file.h"
+#include "include/global_definitions.h"
+
+// Standard includes
+#include <iostream>
+#include <fstream>
+#include <utility> // for move
+
+AdictReader::AdictReader(Adict& adict) : adict(adict) {}
+
+void AdictReader::set_word_handler(WordHandler handler) {
+    word_handler = std::move(handler);
+}
+
+void AdictReader::parse_file(const std::string& fpath) {
+    // Parse straight from a mapping of the file when possible, falling back to a stream otherwise
+    MappedFile mf(fpath, Adict::copy_sources.load());
+    if (mf.is_open()) {
+        nlohmann::json::sax_parse(mf.data(), mf.data() + mf.size(), this);
+    } else {
+        std::ifstream f(fpath);
+        nlohmann::json::sax_parse(f, this);
+    }
+}
+
+// Scalars
+
+bool AdictReader::null() {
+    return true;
+}
+
+bool AdictReader::boolean(bool val) {
+    std::string s = val ? "true" : "false";
+    return value(s);
+}
+
+bool AdictReader::number_integer(number_integer_t val) {
+    std::string s = std::to_string(val);
+    return value(s);
+}
+
+bool AdictReader::number_unsigned(number_unsigned_t val) {
+    std::string s = std::to_string(val);
+    return value(s);
+}
+
+bool AdictReader::number_float(number_float_t val, const string_t& s) {
+    std::string copy = s;
+    return value(copy);
+}
+
+bool AdictReader::string(string_t& val) {
+    return value(val);
+}
+
+bool AdictReader::binary(binary_t& val) {
+    return true;
+}
+
+bool AdictReader::value(string_t& val) {
+    if (skip_depth > 0) {
+        return true;
+    }
+
+    switch (state) {
+        case META:
+            adict.meta[cur_key] = std::move(val);
+            break;
+
+        case META_SUBTITLES:
+            adict.subtitles.push_back(std::move(val));
+            break;
+
+        case STYLE:
+            adict.style[cur_key] = std::move(val);
+            break;
+
+        case CATEGORY_ORDER:
+            adict.category_order.push_back(std::move(val));
+            break;
+
+        case CONFIG:
+            if (cur_key == "collation") {
+                adict.collation = std::move(val);
+            }
+            break;
+
+        case CONFIG_FIELD:
+            if (cur_key == "key") {
+                field_format.key = std::move(val);
+            } else if (cur_key == "label") {
+                field_format.label = std::move(val);
+            } else if (cur_key == "separator") {
+                field_format.separator = std::move(val);
+            } else if (cur_key == "quote") {
+                field_format.quote = std::move(val);
+            }
+            break;
+
+        // Word text is copied rather than moved: val is the lexer's token buffer, taking it would make the lexer
+        // grow a new one for every value, while copies reuse the capacity of the reused Word
+        case WORD:
+            switch (word_key) {
+                case KEY_NAME:
+                    word.name.assign(val);
+                    break;
+
+                case KEY_DEFINITION:
+                    word.definition.assign(val);
+                    break;
+
+                case KEY_CATEGORY:
+                    word_category.assign(val);
+                    word_has_category = true;
+                    break;
+
+                default:
+                    // Single entries are allowed in place of one element arrays
+                    get_word_list_field()->push_back(val);
+                    break;
+            }
+            break;
+
+        case WORD_FIELD_ARRAY:
+            word_field->push_back(val);
+            break;
+
+        default:
+            break;
+    }
+    return true;
+}
+
+// Containers
+
+bool AdictReader::key(string_t& val) {
+    if (skip_depth == 0) {
+        cur_key = val;
+        if (state == WORD) {
+            word_key = find_word_key(cur_key);
+        }
+    }
+    return true;
+}
+
+bool AdictReader::start_object(std::size_t elements) {
+    if (skip_depth > 0) {
+        skip_depth++;
+        return true;
+    }
+
+    switch (state) {
+        case TOP:
+            state = ROOT;
+            break;
+
+        case ROOT:
+            if (cur_key == "meta") {
+                state = META;
+            } else if (cur_key == "style") {
+                state = STYLE;
+            } else if (cur_key == "config") {
+                state = CONFIG;
+            } else {
+                skip_depth = 1;
+            }
+            break;
+
+        case CONFIG_FIELDS:
+            field_format = FieldFormat();
+            state = CONFIG_FIELD;
+            break;
+
+        case WORDS:
+            word.clear();
+            word_category.clear();
+            word_has_category = false;
+            word_dropped = false;
+            state = WORD;
+            break;
+
+        default:
+            skip_depth = 1;
+            break;
+    }
+    return true;
+}
+
+bool AdictReader::end_object() {
+    if (skip_depth > 0) {
+        skip_depth--;
+        return true;
+    }
+
+    switch (state) {
+        case ROOT:
+            state = TOP;
+            break;
+
+        case META:
+        case STYLE:
+        case CONFIG:
+            state = ROOT;
+            break;
+
+        case CONFIG_FIELD:
+            if (!field_format.key.empty()) {
+                if (field_format.label.empty()) {
+                    field_format.label = field_format.key;
+                }
+                adict.field_formats.push_back(std::move(field_format));
+            }
+            state = CONFIG_FIELDS;
+            break;
+
+        case WORD:
+            commit_word();
+            state = WORDS;
+            break;
+
+        default:
+            break;
+    }
+    return true;
+}
+
+bool AdictReader::start_array(std::size_t elements) {
+    if (skip_depth > 0) {
+        skip_depth++;
+        return true;
+    }
+
+    switch (state) {
+        case ROOT:
+            if (cur_key == "words") {
+                state = WORDS;
+            } else {
+                skip_depth = 1;
+            }
+            break;
+
+        case META:
+            // Only parse known arrays (currently only subtitles)
+            if (cur_key == "subtitles") {
+                state = META_SUBTITLES;
+            } else {
+                skip_depth = 1;
+            }
+            break;
+
+        case CONFIG:
+            if (cur_key == "category_order") {
+                adict.category_order.clear();
+                state = CATEGORY_ORDER;
+            } else if (cur_key == "fields") {
+                adict.field_formats.clear();
+                state = CONFIG_FIELDS;
+            } else {
+                skip_depth = 1;
+            }
+            break;
+
+        case WORD:
+            if (word_key == KEY_CATEGORY) {
+                std::cerr << "Error, each word can only be in one category" << newl;
+                word_dropped = true;
+                skip_depth = 1;
+            } else if ((word_key == KEY_NAME) || (word_key == KEY_DEFINITION)) {
+                skip_depth = 1;
+            } else {
+                word_field = get_word_list_field();
+                state = WORD_FIELD_ARRAY;
+            }
+            break;
+
+        default:
+            skip_depth = 1;
+            break;
+    }
+    return true;
+}
+
+bool AdictReader::end_array() {
+    if (skip_depth > 0) {
+        skip_depth--;
+        return true;
+    }
+
+    switch (state) {
+        case META_SUBTITLES:
+            state = META;
+            break;
+
+        case CATEGORY_ORDER:
+        case CONFIG_FIELDS:
+            state = CONFIG;
+            break;
+
+        case WORDS:
+            state = ROOT;
+            break;
+
+        case WORD_FIELD_ARRAY:
+            word_field = nullptr;
+            state = WORD;
+            break;
+
+        default:
+            break;
+    }
+    return true;
+}
+
+// Helpers
+
+// Known keys have different lengths except category and examples, so the length and first letter pick the only
+// candidate and one compare confirms it
+AdictReader::WordKey AdictReader::find_word_key(const std::string& key) {
+    WordKey candidate;
+    const char* expected;
+    switch (key.size()) {
+        case 4:
+            candidate = KEY_NAME;
+            expected = "name";
+            break;
+
+        case 5:
+            candidate = KEY_NOTES;
+            expected = "notes";
+            break;
+
+        case 8:
+            if (key[0] == 'c') {
+                candidate = KEY_CATEGORY;
+                expected = "category";
+            } else {
+                candidate = KEY_EXAMPLES;
+                expected = "examples";
+            }
+            break;
+
+        case 9:
+            candidate = KEY_ETYMOLOGY;
+            expected = "etymology";
+            break;
+
+        case 10:
+            candidate = KEY_DEFINITION;
+            expected = "definition";
+            break;
+
+        case 12:
+            candidate = KEY_INSPIRATIONS;
+            expected = "inspirations";
+            break;
+
+        case 17:
+            candidate = KEY_EXAMPLE_SENTENCES;
+            expected = "example_sentences";
+            break;
+
+        default:
+            return KEY_EXTRA;
+    }
+    return (key.compare(expected) == 0) ? candidate : KEY_EXTRA;
+}
+
+std::vector<std::string>* AdictReader::get_word_list_field() {
+    switch (word_key) {
+        case KEY_ETYMOLOGY:
+            return &word.etymology;
+        case KEY_EXAMPLES:
+            return &word.examples;
+        case KEY_EXAMPLE_SENTENCES:
+            return &word.example_sentences;
+        case KEY_INSPIRATIONS:
+            return &word.inspirations;
+        case KEY_NOTES:
+            return &word.notes;
+        default:
+            return word.get_extra_field(cur_key);
+    }
+}
+
+void AdictReader::commit_word() {
+    if (word_dropped) {
+        return;
+    }
+
+    if (word_handler) {
+        word_handler(word_has_category ? word_category : std::string("*"), word);
+    } else if (word_has_category) {
+        adict.words_by_category[word_category].push_back(adict.words.add(word));
+    } else {
+        adict.words_by_category["*"].push_back(adict.words.add(word));
+    }
+}
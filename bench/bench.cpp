@@ -0,0 +1,523 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Benchmarks the stages of an Adict build (read, cached load, print, compile, save), the sort backends, the
+// full-text index and the headword trie on a generated dictionary. Run build/adict_bench --help for the options.
+
+// Program includes
+#include "../include/adict.h"
+#include "../include/word_sort.h"
+#include "../include/collation.h"
+#include "../include/thread_pool.h"
+#include "../include/stats.h"
+#include "../include/text_index.h"
+#include "../include/headword_trie.h"
+#include "../include/utf8.h"
+#include "dict_generator.h"
+
+// Library include
+#include "../include/json.hpp"
+using json = nlohmann::json;
+
+// System includes
+#include <unistd.h>
+
+// Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <tuple>
+
+namespace {
+
+// Searches made by the query and lookup benchmarks
+const size_t QUERY_COUNT = 1000;
+
+// Names asked for by the autocomplete benchmark
+const size_t COMPLETE_LIMIT = 10;
+
+// Searches made by the fuzzy baseline, which scans every name
+const size_t FUZZY_SCAN_COUNT = 20;
+
+// Swallows output and counts its bytes, print() is pointed at this
+class CountingBuffer : public std::streambuf {
+public:
+    size_t count = 0;
+
+protected:
+    int overflow(int c) override {
+        count++;
+        return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        count += n;
+        return n;
+    }
+};
+
+struct Result {
+    std::string name;
+    size_t repetitions = 0;
+    double min_ms = 0;
+    double mean_ms = 0;
+    size_t allocations = 0; // per repetition
+    size_t words = 0;
+    size_t bytes = 0; // per repetition, 0 if it doesn't apply
+};
+
+// Runs f repetitions times, f returns the number of bytes it processed
+Result run(const std::string& name, size_t repetitions, size_t words, const std::function<size_t()>& f) {
+    Result r;
+    r.name = name;
+    r.repetitions = repetitions;
+    r.words = words;
+
+    double total = 0;
+    for (size_t i = 0; i < repetitions; i++) {
+        size_t allocations_before = Stats::get_allocation_count();
+        auto start = std::chrono::steady_clock::now();
+        r.bytes = f();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        r.allocations = Stats::get_allocation_count() - allocations_before;
+
+        total += ms;
+        if ((i == 0) || (ms < r.min_ms)) {
+            r.min_ms = ms;
+        }
+    }
+    r.mean_ms = total / repetitions;
+    return r;
+}
+
+std::string format_rate(double per_second, const std::string& unit) {
+    const char* prefixes[] = {"", "k", "M", "G"};
+    size_t p = 0;
+    while ((per_second >= 1000) && (p < 3)) {
+        per_second /= 1000;
+        p++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << per_second << prefixes[p] << unit << "/s";
+    return ss.str();
+}
+
+void print_table(const std::vector<Result>& results) {
+    std::string line(96, '-');
+    std::cout << line << "\n";
+    std::cout << std::left << std::setw(24) << "Benchmark" << std::right << std::setw(12) << "Min" << std::setw(12) << "Mean"
+        << std::setw(12) << "Allocs" << std::setw(18) << "Words" << std::setw(18) << "Bytes" << "\n";
+    std::cout << line << "\n";
+
+    for (const Result& r : results) {
+        double seconds = r.min_ms / 1000;
+        std::ostringstream min_ms;
+        std::ostringstream mean_ms;
+        min_ms << std::fixed << std::setprecision(2) << r.min_ms << " ms";
+        mean_ms << std::fixed << std::setprecision(2) << r.mean_ms << " ms";
+
+        std::cout << std::left << std::setw(24) << r.name << std::right << std::setw(12) << min_ms.str() << std::setw(12) << mean_ms.str()
+            << std::setw(12) << r.allocations
+            << std::setw(18) << ((seconds > 0) ? format_rate(r.words / seconds, "") : "-")
+            << std::setw(18) << (((seconds > 0) && (r.bytes > 0)) ? format_rate(r.bytes / seconds, "B") : "-") << "\n";
+    }
+}
+
+void print_json(const std::vector<Result>& results, const DictGenerator::Options& options, size_t json_size) {
+    json out;
+    out["context"]["words"] = options.word_count;
+    out["context"]["fanout"] = options.fanout;
+    out["context"]["categories"] = options.category_count;
+    out["context"]["scripts"] = options.scripts;
+    out["context"]["seed"] = options.seed;
+    out["context"]["json_bytes"] = json_size;
+
+    out["benchmarks"] = json::array();
+    for (const Result& r : results) {
+        double seconds = r.min_ms / 1000;
+        json b;
+        b["name"] = r.name;
+        b["repetitions"] = r.repetitions;
+        b["min_ms"] = r.min_ms;
+        b["mean_ms"] = r.mean_ms;
+        b["allocations"] = r.allocations;
+        b["words_per_second"] = (seconds > 0) ? r.words / seconds : 0;
+        b["bytes_per_second"] = (seconds > 0) ? r.bytes / seconds : 0;
+        out["benchmarks"].push_back(b);
+    }
+    std::cout << out.dump(2) << "\n";
+}
+
+void print_usage() {
+    std::cout << "Usage: adict_bench [options]" << "\n\n"
+        << "  --words N         number of words (default 10000)" << "\n"
+        << "  --fanout N        maximum entries per list field (default 3)" << "\n"
+        << "  --categories N    number of categories, 0 for none (default 4)" << "\n"
+        << "  --scripts A,B     scripts to mix:";
+    for (const std::string& s : DictGenerator::get_script_names()) {
+        std::cout << " " << s;
+    }
+    std::cout << " (default latin)" << "\n"
+        << "  --seed N          generator seed (default 1)" << "\n"
+        << "  --repetitions N   runs per benchmark (default 3)" << "\n"
+        << "  -j N              threads for the parallel compile benchmark, 0 for automatic (default 0)" << "\n"
+        << "  --json            print results as JSON" << "\n";
+}
+
+bool parse_count(const std::string& s, size_t& out) {
+    if (s.empty() || (s.find_first_not_of("0123456789") != std::string::npos)) {
+        return false;
+    }
+    out = std::stoul(s);
+    return true;
+}
+
+size_t get_file_size(const std::string& path) {
+    std::error_code ec;
+    size_t size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+// Removes the files the bench writes however it ends
+struct TempFiles {
+    std::vector<std::string> paths;
+
+    ~TempFiles() {
+        for (const std::string& path : paths) {
+            std::remove(path.c_str());
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    DictGenerator::Options options;
+    size_t repetitions = 3;
+    size_t thread_count = 0;
+    bool json_output = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = (i + 1 < argc) ? argv[i + 1] : "";
+        size_t n = 0;
+
+        if (arg == "--json") {
+            json_output = true;
+            continue;
+        } else if ((arg == "--help") || (arg == "-h")) {
+            print_usage();
+            return 0;
+        } else if (arg == "--scripts") {
+            options.scripts.clear();
+            std::stringstream ss(value);
+            std::string s;
+            while (std::getline(ss, s, ',')) {
+                if (!DictGenerator::is_known_script(s)) {
+                    std::cerr << "Unknown script: " << s << "\n";
+                    return 1;
+                }
+                options.scripts.push_back(s);
+            }
+            i++;
+            continue;
+        }
+
+        if (!parse_count(value, n)) {
+            std::cerr << "Unknown option or missing value: " << arg << "\n";
+            print_usage();
+            return 1;
+        }
+        i++;
+
+        if (arg == "--words") {
+            options.word_count = n;
+        } else if (arg == "--fanout") {
+            options.fanout = n;
+        } else if (arg == "--categories") {
+            options.category_count = n;
+        } else if (arg == "--seed") {
+            options.seed = n;
+        } else if (arg == "--repetitions") {
+            repetitions = (n > 0) ? n : 1;
+        } else if (arg == "-j") {
+            thread_count = n;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (thread_count == 0) {
+        thread_count = ThreadPool::get_default_thread_count();
+    }
+
+    // Generate the input
+    std::filesystem::path tmp = std::filesystem::temp_directory_path();
+    std::string base = (tmp / ("adict_bench_" + std::to_string(getpid()))).string();
+    std::string json_path = base + ".json";
+    std::string docx_path = base + ".docx";
+    std::string cache_path = Adict::get_cache_path(json_path);
+    TempFiles temp_files{{json_path, cache_path, docx_path}};
+    {
+        std::string doc = DictGenerator::generate(options);
+        std::ofstream f(json_path, std::ios::binary);
+        f << doc;
+    }
+    size_t json_size = get_file_size(json_path);
+    size_t words = options.word_count;
+
+    std::vector<Result> results;
+
+    // Stages
+    Adict adict;
+    results.push_back(run("read", repetitions, words, [&] {
+        adict = Adict::read(json_path);
+        return json_size;
+    }));
+
+    Adict::load(json_path); // writes the cache
+    size_t cache_size = get_file_size(cache_path);
+    results.push_back(run("load (cached)", repetitions, words, [&] {
+        adict = Adict::load(json_path);
+        return cache_size;
+    }));
+
+    CountingBuffer counter;
+    results.push_back(run("print", repetitions, words, [&] {
+        counter.count = 0;
+        std::streambuf* old = std::cout.rdbuf(&counter);
+        adict.print();
+        std::cout.rdbuf(old);
+        return counter.count;
+    }));
+
+    results.push_back(run("compile", repetitions, words, [&] {
+        adict.compile(1);
+        return size_t(0);
+    }));
+
+    if (thread_count > 1) {
+        results.push_back(run("compile/threads:" + std::to_string(thread_count), repetitions, words, [&] {
+            adict.compile(thread_count);
+            return size_t(0);
+        }));
+    }
+
+    results.push_back(run("read+compile/pipelined", repetitions, words, [&] {
+        Adict pipelined;
+        pipelined.read_and_compile(json_path, thread_count);
+        return json_size;
+    }));
+
+    ParagraphCache cache;
+    adict.compile(1, &cache);
+    results.push_back(run("compile (all cached)", repetitions, words, [&] {
+        adict.compile(1, &cache);
+        return size_t(0);
+    }));
+
+    DOCX docx = adict.compile(1);
+    results.push_back(run("save", repetitions, words, [&] {
+        docx.save(docx_path);
+        return get_file_size(docx_path);
+    }));
+
+    // Full-text index, queried with the first term of the first definitions
+    {
+        TextIndex index;
+        results.push_back(run("index build", repetitions, words, [&] {
+            index = TextIndex::build(adict);
+            return size_t(0);
+        }));
+
+        std::vector<std::string> queries;
+        std::vector<std::string> terms;
+        for (uint32_t w_i = 0; (w_i < index.size()) && (queries.size() < QUERY_COUNT); w_i++) {
+            terms.clear();
+            TextIndex::tokenize(index.get_definition(w_i), terms);
+            if (!terms.empty()) {
+                queries.push_back(terms[0]);
+            }
+        }
+
+        results.push_back(run("query", repetitions, queries.size(), [&] {
+            for (const std::string& q : queries) {
+                index.search(q);
+            }
+            return size_t(0);
+        }));
+    }
+
+    // Headword trie, looked up with the first names, their first two bytes as prefixes and with their first two
+    // characters swapped for fuzzy lookups
+    {
+        HeadwordTrie trie;
+        results.push_back(run("trie build", repetitions, words, [&] {
+            trie = HeadwordTrie::build(adict);
+            return size_t(0);
+        }));
+
+        // Generated names repeat, each is looked up once
+        std::vector<std::string> names;
+        for (const HeadwordTrie::Match& m : trie.find_prefix("")) {
+            if (names.size() == QUERY_COUNT) {
+                break;
+            }
+            if (names.empty() || (names.back() != m.name)) {
+                names.push_back(std::string(m.name));
+            }
+        }
+
+        results.push_back(run("lookup", repetitions, names.size(), [&] {
+            for (const std::string& name : names) {
+                trie.find(name);
+            }
+            return size_t(0);
+        }));
+
+        results.push_back(run("complete", repetitions, names.size(), [&] {
+            for (const std::string& name : names) {
+                trie.complete(std::string_view(name).substr(0, 2), COMPLETE_LIMIT);
+            }
+            return size_t(0);
+        }));
+
+        std::vector<std::string> typos;
+        for (const std::string& name : names) {
+            std::vector<uint32_t> code_points;
+            size_t i = 0;
+            while (i < name.size()) {
+                code_points.push_back(next_code_point(name, i));
+            }
+            if (code_points.size() > 1) {
+                std::swap(code_points[0], code_points[1]);
+            }
+            std::string typo;
+            for (uint32_t cp : code_points) {
+                append_code_point(typo, cp);
+            }
+            typos.push_back(typo);
+        }
+
+        results.push_back(run("fuzzy (1 edit)", repetitions, typos.size(), [&] {
+            for (const std::string& typo : typos) {
+                trie.find_fuzzy(typo, 1);
+            }
+            return size_t(0);
+        }));
+
+        results.push_back(run("fuzzy (2 edits)", repetitions, typos.size(), [&] {
+            for (const std::string& typo : typos) {
+                trie.find_fuzzy(typo, 2);
+            }
+            return size_t(0);
+        }));
+
+        // Baseline for the above: the edit distance to every name
+        std::vector<HeadwordTrie::Match> all = trie.find_prefix("");
+        size_t scan_count = std::min(typos.size(), FUZZY_SCAN_COUNT);
+        results.push_back(run("fuzzy (2 edits, scan)", repetitions, scan_count, [&] {
+            for (size_t q_i = 0; q_i < scan_count; q_i++) {
+                for (const HeadwordTrie::Match& m : all) {
+                    HeadwordTrie::get_edit_distance(m.name, typos[q_i]);
+                }
+            }
+            return size_t(0);
+        }));
+
+        // The trie has to find what the scan finds
+        using Found = std::tuple<uint32_t, std::string_view, std::string_view, uint32_t>; // distance, name, category, word
+        for (size_t q_i = 0; q_i < scan_count; q_i++) {
+            std::vector<Found> scanned;
+            for (const HeadwordTrie::Match& m : all) {
+                size_t d = HeadwordTrie::get_edit_distance(m.name, typos[q_i]);
+                if (d <= 2) {
+                    scanned.emplace_back(d, m.name, m.category, m.word);
+                }
+            }
+            std::vector<Found> found;
+            for (const HeadwordTrie::Match& m : trie.find_fuzzy(typos[q_i], 2)) {
+                found.emplace_back(m.distance, m.name, m.category, m.word);
+            }
+            std::sort(scanned.begin(), scanned.end());
+            std::sort(found.begin(), found.end());
+            if (found != scanned) {
+                std::cerr << "Fuzzy lookup of " << typos[q_i] << " found " << found.size() << " words, the scan " << scanned.size() << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // Sort backends on every headword as one list
+    {
+        json doc = json::parse(std::ifstream(json_path));
+        std::vector<std::string> names(doc["words"].size());
+        std::vector<std::string> sort_keys(names.size());
+        std::vector<std::string_view> keys(names.size());
+        for (size_t w_i = 0; w_i < names.size(); w_i++) {
+            names[w_i] = doc["words"][w_i]["name"];
+            sort_keys[w_i] = Collation::get_sort_key(names[w_i]);
+            keys[w_i] = sort_keys[w_i];
+        }
+
+        std::vector<size_t> order(names.size());
+        auto reset = [&order] {
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+        };
+
+        // Into a vector of their own, keys views sort_keys
+        std::vector<std::string> timed_keys(names.size());
+        results.push_back(run("sort keys", repetitions, words, [&] {
+            size_t bytes = 0;
+            for (size_t w_i = 0; w_i < names.size(); w_i++) {
+                timed_keys[w_i] = Collation::get_sort_key(names[w_i]);
+                bytes += names[w_i].size();
+            }
+            return bytes;
+        }));
+
+        results.push_back(run("sort/std::sort", repetitions, words, [&] {
+            reset();
+            comparison_sort_indices(keys, order, 0, order.size());
+            return size_t(0);
+        }));
+
+        results.push_back(run("sort/radix", repetitions, words, [&] {
+            reset();
+            radix_sort_indices(keys, order, 0, order.size());
+            return size_t(0);
+        }));
+    }
+
+    results.push_back(run("write_docx (streamed)", repetitions, words, [&] {
+        adict.write_docx(docx_path, 1);
+        return get_file_size(docx_path);
+    }));
+
+    if (json_output) {
+        print_json(results, options, json_size);
+    } else {
+        std::cout << words << " words, " << json_size << " bytes of JSON" << "\n";
+        print_table(results);
+    }
+    return 0;
+}
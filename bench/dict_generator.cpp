@@ -0,0 +1,147 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "dict_generator.h"
+
+// Library include
+#include "../include/json.hpp"
+using json = nlohmann::json;
+
+// Standard includes
+#include <map>
+#include <random>
+
+namespace {
+
+// Syllables words are made of, per script
+const std::map<std::string, std::vector<std::string>> SYLLABLES = {
+    {"latin", {"ka", "ro", "mi", "te", "lu", "sa", "ne", "po", "zi", "ber", "al", "st", "qu", "é", "ö", "ñ"}},
+    {"greek", {"λο", "γα", "μι", "τε", "πα", "νο", "ρη", "σι", "κά", "θε", "φω", "ψυ"}},
+    {"cyrillic", {"ва", "ко", "ри", "ны", "ст", "ло", "же", "ёл", "йо", "да", "му", "ще"}},
+    {"japanese", {"か", "き", "さ", "ち", "ね", "の", "が", "ぱ", "カ", "ト", "日", "本", "語"}},
+    {"arabic", {"كت", "ب", "سل", "ام", "مر", "حب", "ع", "لم", "قل", "نور"}},
+    {"devanagari", {"क", "ख", "ग", "न", "म", "र", "स", "ति", "ना", "मा", "शा"}}
+};
+
+class Generator {
+public:
+    Generator(const DictGenerator::Options& options) : options(options), rng(options.seed) {
+        for (const std::string& s : options.scripts) {
+            auto it = SYLLABLES.find(s);
+            if (it != SYLLABLES.end()) {
+                scripts.push_back(&it->second);
+            }
+        }
+        if (scripts.empty()) {
+            scripts.push_back(&SYLLABLES.at("latin"));
+        }
+    }
+
+    std::string word(const std::vector<std::string>& syllables) {
+        std::string w;
+        size_t n = 1 + rng() % 4;
+        for (size_t i = 0; i < n; i++) {
+            w += syllables[rng() % syllables.size()];
+        }
+        return w;
+    }
+
+    std::string phrase(const std::vector<std::string>& syllables, size_t words) {
+        std::string p;
+        for (size_t i = 0; i < words; i++) {
+            if (i > 0) {
+                p += ' ';
+            }
+            p += word(syllables);
+        }
+        return p;
+    }
+
+    // Between 0 and fanout entries, single entries are sometimes written as plain strings like people do
+    void add_list(json& entry, const char* key, const std::vector<std::string>& syllables, size_t phrase_words) {
+        if (options.fanout == 0) {
+            return;
+        }
+        size_t n = rng() % (options.fanout + 1);
+        if (n == 0) {
+            return;
+        }
+        if ((n == 1) && (rng() % 2 == 0)) {
+            entry[key] = phrase(syllables, phrase_words);
+            return;
+        }
+        json list = json::array();
+        for (size_t i = 0; i < n; i++) {
+            list.push_back(phrase(syllables, phrase_words));
+        }
+        entry[key] = list;
+    }
+
+    std::string generate() {
+        json doc;
+        doc["meta"]["title"] = "Benchmark Dictionary";
+        doc["meta"]["subtitles"] = json::array({"generated", "seed " + std::to_string(options.seed)});
+        doc["style"]["title_size"] = "24";
+
+        std::vector<std::string> categories;
+        for (size_t c = 0; c < options.category_count; c++) {
+            categories.push_back("category " + std::to_string(c));
+        }
+        if (!categories.empty()) {
+            doc["config"]["category_order"] = categories;
+        }
+
+        json words = json::array();
+        for (size_t w_i = 0; w_i < options.word_count; w_i++) {
+            const std::vector<std::string>& syllables = *scripts[w_i % scripts.size()];
+            json entry;
+            entry["name"] = word(syllables);
+            entry["definition"] = phrase(syllables, 3 + rng() % 8);
+            add_list(entry, "etymology", syllables, 1);
+            add_list(entry, "examples", syllables, 2);
+            add_list(entry, "example_sentences", syllables, 6);
+            add_list(entry, "inspirations", syllables, 1);
+            add_list(entry, "notes", syllables, 5);
+            if (!categories.empty()) {
+                entry["category"] = categories[rng() % categories.size()];
+            }
+            words.push_back(std::move(entry));
+        }
+        doc["words"] = std::move(words);
+        return doc.dump(1);
+    }
+
+private:
+    const DictGenerator::Options& options;
+    std::mt19937 rng;
+    std::vector<const std::vector<std::string>*> scripts;
+};
+
+} // namespace
+
+std::string DictGenerator::generate(const Options& options) {
+    Generator g(options);
+    return g.generate();
+}
+
+bool DictGenerator::is_known_script(const std::string& name) {
+    return SYLLABLES.find(name) != SYLLABLES.end();
+}
+
+std::vector<std::string> DictGenerator::get_script_names() {
+    std::vector<std::string> names;
+    for (const auto& [name, syllables] : SYLLABLES) {
+        names.push_back(name);
+    }
+    return names;
+}
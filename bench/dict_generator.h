@@ -0,0 +1,37 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DICT_GENERATOR_H
+#define DICT_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds synthetic Adict JSON documents for benchmarking
+class DictGenerator {
+public:
+    struct Options {
+        size_t word_count = 10000;
+        size_t fanout = 3; // maximum number of entries in each list field
+        size_t category_count = 4; // 0 puts every word in the default category
+        std::vector<std::string> scripts = {"latin"}; // names as accepted by is_known_script, mixed evenly
+        uint32_t seed = 1;
+    };
+
+    static std::string generate(const Options& options);
+
+    static bool is_known_script(const std::string& name);
+    static std::vector<std::string> get_script_names();
+};
+
+#endif
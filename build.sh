@@ -1,2 +1,8 @@
 mkdir -p build
-g++ -o build/adict main.cpp adict.cpp
\ No newline at end of file
+SOURCES="adict.cpp adict_reader.cpp word_table.cpp word_renderer.cpp mapped_file.cpp adict_cache.cpp thread_pool.cpp word_sort.cpp collation.cpp paragraph_cache.cpp file_watcher.cpp stats.cpp text_index.cpp headword_trie.cpp live_dictionary.cpp lookup_server.cpp adict_pipeline.cpp zip_writer.cpp docx_stream.cpp"
+
+if [ "$1" = "bench" ]; then
+    g++ -O2 -o build/adict_bench bench/bench.cpp bench/dict_generator.cpp $SOURCES -pthread -lz
+else
+    g++ -o build/adict main.cpp $SOURCES -pthread -lz
+fi
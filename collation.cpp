@@ -0,0 +1,552 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Sort key layout (ROOT):
+
+    primary weights (4 bytes each, first byte is the script group so never 0)  00
+    secondary weights (1 byte each)                                            00
+    tertiary weights (1 byte each)                                             00
+    the original UTF-8 string
+
+A collation element only contributes to the levels where its weight is non-zero,
+so combining marks add a secondary weight without adding a primary one.
+*/
+
+// Program includes
+#include "include/collation.h"
+#include "include/utf8.h"
+
+// Standard includes
+#include <algorithm> // for lower_bound
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Primary weight groups, in sort order
+const uint8_t GROUP_VARIABLE = 1; // spaces, punctuation and symbols
+const uint8_t GROUP_DIGIT = 2;
+const uint8_t GROUP_LATIN = 3;
+const uint8_t GROUP_GREEK = 4;
+const uint8_t GROUP_CYRILLIC = 5;
+const uint8_t GROUP_ARABIC = 6;
+const uint8_t GROUP_DEVANAGARI = 7;
+const uint8_t GROUP_KANA = 8;
+const uint8_t GROUP_OTHER = 9;
+
+// Secondary weights
+const uint8_t SECONDARY_NONE = 0x05;
+const uint8_t SECONDARY_COMBINING = 0x10; // + (mark - U+0300), up to 0x7F
+const uint8_t SECONDARY_DAKUTEN = 0x80;
+const uint8_t SECONDARY_HANDAKUTEN = 0x81;
+const uint8_t SECONDARY_STROKE = 0x82;
+const uint8_t SECONDARY_DOTLESS = 0x83;
+const uint8_t SECONDARY_NUKTA = 0x84;
+const uint8_t SECONDARY_ARABIC_MARK = 0x90; // + (mark - U+064B), up to 0xA5
+
+// Tertiary weights
+const uint8_t TERTIARY_SMALL = 0x04; // small kana
+const uint8_t TERTIARY_LOWER = 0x05;
+const uint8_t TERTIARY_UPPER = 0x06;
+const uint8_t TERTIARY_VARIANT = 0x07; // katakana, final sigma, long s
+const uint8_t TERTIARY_EXPANSION = 0x08; // letters expanded to two (æ, ß, œ)
+const uint8_t TERTIARY_EXPANSION_UPPER = 0x09;
+
+struct Element {
+    uint32_t primary;
+    uint8_t secondary;
+    uint8_t tertiary;
+};
+
+struct Decomposition {
+    uint32_t cp;
+    uint32_t base;
+    uint32_t mark1;
+    uint32_t mark2;
+};
+
+// Canonical decompositions (NFD) of the precomposed letters in Latin-1 Supplement, Latin Extended-A/B,
+// Greek, Cyrillic and Latin Extended Additional, sorted by code point
+const Decomposition DECOMPOSITIONS[] = {
+    {0x00C0, 0x0041, 0x0300, 0x0000}, {0x00C1, 0x0041, 0x0301, 0x0000}, {0x00C2, 0x0041, 0x0302, 0x0000}, {0x00C3, 0x0041, 0x0303, 0x0000},
+    {0x00C4, 0x0041, 0x0308, 0x0000}, {0x00C5, 0x0041, 0x030A, 0x0000}, {0x00C7, 0x0043, 0x0327, 0x0000}, {0x00C8, 0x0045, 0x0300, 0x0000},
+    {0x00C9, 0x0045, 0x0301, 0x0000}, {0x00CA, 0x0045, 0x0302, 0x0000}, {0x00CB, 0x0045, 0x0308, 0x0000}, {0x00CC, 0x0049, 0x0300, 0x0000},
+    {0x00CD, 0x0049, 0x0301, 0x0000}, {0x00CE, 0x0049, 0x0302, 0x0000}, {0x00CF, 0x0049, 0x0308, 0x0000}, {0x00D1, 0x004E, 0x0303, 0x0000},
+    {0x00D2, 0x004F, 0x0300, 0x0000}, {0x00D3, 0x004F, 0x0301, 0x0000}, {0x00D4, 0x004F, 0x0302, 0x0000}, {0x00D5, 0x004F, 0x0303, 0x0000},
+    {0x00D6, 0x004F, 0x0308, 0x0000}, {0x00D9, 0x0055, 0x0300, 0x0000}, {0x00DA, 0x0055, 0x0301, 0x0000}, {0x00DB, 0x0055, 0x0302, 0x0000},
+    {0x00DC, 0x0055, 0x0308, 0x0000}, {0x00DD, 0x0059, 0x0301, 0x0000}, {0x00E0, 0x0061, 0x0300, 0x0000}, {0x00E1, 0x0061, 0x0301, 0x0000},
+    {0x00E2, 0x0061, 0x0302, 0x0000}, {0x00E3, 0x0061, 0x0303, 0x0000}, {0x00E4, 0x0061, 0x0308, 0x0000}, {0x00E5, 0x0061, 0x030A, 0x0000},
+    {0x00E7, 0x0063, 0x0327, 0x0000}, {0x00E8, 0x0065, 0x0300, 0x0000}, {0x00E9, 0x0065, 0x0301, 0x0000}, {0x00EA, 0x0065, 0x0302, 0x0000},
+    {0x00EB, 0x0065, 0x0308, 0x0000}, {0x00EC, 0x0069, 0x0300, 0x0000}, {0x00ED, 0x0069, 0x0301, 0x0000}, {0x00EE, 0x0069, 0x0302, 0x0000},
+    {0x00EF, 0x0069, 0x0308, 0x0000}, {0x00F1, 0x006E, 0x0303, 0x0000}, {0x00F2, 0x006F, 0x0300, 0x0000}, {0x00F3, 0x006F, 0x0301, 0x0000},
+    {0x00F4, 0x006F, 0x0302, 0x0000}, {0x00F5, 0x006F, 0x0303, 0x0000}, {0x00F6, 0x006F, 0x0308, 0x0000}, {0x00F9, 0x0075, 0x0300, 0x0000},
+    {0x00FA, 0x0075, 0x0301, 0x0000}, {0x00FB, 0x0075, 0x0302, 0x0000}, {0x00FC, 0x0075, 0x0308, 0x0000}, {0x00FD, 0x0079, 0x0301, 0x0000},
+    {0x00FF, 0x0079, 0x0308, 0x0000}, {0x0100, 0x0041, 0x0304, 0x0000}, {0x0101, 0x0061, 0x0304, 0x0000}, {0x0102, 0x0041, 0x0306, 0x0000},
+    {0x0103, 0x0061, 0x0306, 0x0000}, {0x0104, 0x0041, 0x0328, 0x0000}, {0x0105, 0x0061, 0x0328, 0x0000}, {0x0106, 0x0043, 0x0301, 0x0000},
+    {0x0107, 0x0063, 0x0301, 0x0000}, {0x0108, 0x0043, 0x0302, 0x0000}, {0x0109, 0x0063, 0x0302, 0x0000}, {0x010A, 0x0043, 0x0307, 0x0000},
+    {0x010B, 0x0063, 0x0307, 0x0000}, {0x010C, 0x0043, 0x030C, 0x0000}, {0x010D, 0x0063, 0x030C, 0x0000}, {0x010E, 0x0044, 0x030C, 0x0000},
+    {0x010F, 0x0064, 0x030C, 0x0000}, {0x0112, 0x0045, 0x0304, 0x0000}, {0x0113, 0x0065, 0x0304, 0x0000}, {0x0114, 0x0045, 0x0306, 0x0000},
+    {0x0115, 0x0065, 0x0306, 0x0000}, {0x0116, 0x0045, 0x0307, 0x0000}, {0x0117, 0x0065, 0x0307, 0x0000}, {0x0118, 0x0045, 0x0328, 0x0000},
+    {0x0119, 0x0065, 0x0328, 0x0000}, {0x011A, 0x0045, 0x030C, 0x0000}, {0x011B, 0x0065, 0x030C, 0x0000}, {0x011C, 0x0047, 0x0302, 0x0000},
+    {0x011D, 0x0067, 0x0302, 0x0000}, {0x011E, 0x0047, 0x0306, 0x0000}, {0x011F, 0x0067, 0x0306, 0x0000}, {0x0120, 0x0047, 0x0307, 0x0000},
+    {0x0121, 0x0067, 0x0307, 0x0000}, {0x0122, 0x0047, 0x0327, 0x0000}, {0x0123, 0x0067, 0x0327, 0x0000}, {0x0124, 0x0048, 0x0302, 0x0000},
+    {0x0125, 0x0068, 0x0302, 0x0000}, {0x0128, 0x0049, 0x0303, 0x0000}, {0x0129, 0x0069, 0x0303, 0x0000}, {0x012A, 0x0049, 0x0304, 0x0000},
+    {0x012B, 0x0069, 0x0304, 0x0000}, {0x012C, 0x0049, 0x0306, 0x0000}, {0x012D, 0x0069, 0x0306, 0x0000}, {0x012E, 0x0049, 0x0328, 0x0000},
+    {0x012F, 0x0069, 0x0328, 0x0000}, {0x0130, 0x0049, 0x0307, 0x0000}, {0x0134, 0x004A, 0x0302, 0x0000}, {0x0135, 0x006A, 0x0302, 0x0000},
+    {0x0136, 0x004B, 0x0327, 0x0000}, {0x0137, 0x006B, 0x0327, 0x0000}, {0x0139, 0x004C, 0x0301, 0x0000}, {0x013A, 0x006C, 0x0301, 0x0000},
+    {0x013B, 0x004C, 0x0327, 0x0000}, {0x013C, 0x006C, 0x0327, 0x0000}, {0x013D, 0x004C, 0x030C, 0x0000}, {0x013E, 0x006C, 0x030C, 0x0000},
+    {0x0143, 0x004E, 0x0301, 0x0000}, {0x0144, 0x006E, 0x0301, 0x0000}, {0x0145, 0x004E, 0x0327, 0x0000}, {0x0146, 0x006E, 0x0327, 0x0000},
+    {0x0147, 0x004E, 0x030C, 0x0000}, {0x0148, 0x006E, 0x030C, 0x0000}, {0x014C, 0x004F, 0x0304, 0x0000}, {0x014D, 0x006F, 0x0304, 0x0000},
+    {0x014E, 0x004F, 0x0306, 0x0000}, {0x014F, 0x006F, 0x0306, 0x0000}, {0x0150, 0x004F, 0x030B, 0x0000}, {0x0151, 0x006F, 0x030B, 0x0000},
+    {0x0154, 0x0052, 0x0301, 0x0000}, {0x0155, 0x0072, 0x0301, 0x0000}, {0x0156, 0x0052, 0x0327, 0x0000}, {0x0157, 0x0072, 0x0327, 0x0000},
+    {0x0158, 0x0052, 0x030C, 0x0000}, {0x0159, 0x0072, 0x030C, 0x0000}, {0x015A, 0x0053, 0x0301, 0x0000}, {0x015B, 0x0073, 0x0301, 0x0000},
+    {0x015C, 0x0053, 0x0302, 0x0000}, {0x015D, 0x0073, 0x0302, 0x0000}, {0x015E, 0x0053, 0x0327, 0x0000}, {0x015F, 0x0073, 0x0327, 0x0000},
+    {0x0160, 0x0053, 0x030C, 0x0000}, {0x0161, 0x0073, 0x030C, 0x0000}, {0x0162, 0x0054, 0x0327, 0x0000}, {0x0163, 0x0074, 0x0327, 0x0000},
+    {0x0164, 0x0054, 0x030C, 0x0000}, {0x0165, 0x0074, 0x030C, 0x0000}, {0x0168, 0x0055, 0x0303, 0x0000}, {0x0169, 0x0075, 0x0303, 0x0000},
+    {0x016A, 0x0055, 0x0304, 0x0000}, {0x016B, 0x0075, 0x0304, 0x0000}, {0x016C, 0x0055, 0x0306, 0x0000}, {0x016D, 0x0075, 0x0306, 0x0000},
+    {0x016E, 0x0055, 0x030A, 0x0000}, {0x016F, 0x0075, 0x030A, 0x0000}, {0x0170, 0x0055, 0x030B, 0x0000}, {0x0171, 0x0075, 0x030B, 0x0000},
+    {0x0172, 0x0055, 0x0328, 0x0000}, {0x0173, 0x0075, 0x0328, 0x0000}, {0x0174, 0x0057, 0x0302, 0x0000}, {0x0175, 0x0077, 0x0302, 0x0000},
+    {0x0176, 0x0059, 0x0302, 0x0000}, {0x0177, 0x0079, 0x0302, 0x0000}, {0x0178, 0x0059, 0x0308, 0x0000}, {0x0179, 0x005A, 0x0301, 0x0000},
+    {0x017A, 0x007A, 0x0301, 0x0000}, {0x017B, 0x005A, 0x0307, 0x0000}, {0x017C, 0x007A, 0x0307, 0x0000}, {0x017D, 0x005A, 0x030C, 0x0000},
+    {0x017E, 0x007A, 0x030C, 0x0000}, {0x01A0, 0x004F, 0x031B, 0x0000}, {0x01A1, 0x006F, 0x031B, 0x0000}, {0x01AF, 0x0055, 0x031B, 0x0000},
+    {0x01B0, 0x0075, 0x031B, 0x0000}, {0x01CD, 0x0041, 0x030C, 0x0000}, {0x01CE, 0x0061, 0x030C, 0x0000}, {0x01CF, 0x0049, 0x030C, 0x0000},
+    {0x01D0, 0x0069, 0x030C, 0x0000}, {0x01D1, 0x004F, 0x030C, 0x0000}, {0x01D2, 0x006F, 0x030C, 0x0000}, {0x01D3, 0x0055, 0x030C, 0x0000},
+    {0x01D4, 0x0075, 0x030C, 0x0000}, {0x01D5, 0x0055, 0x0308, 0x0304}, {0x01D6, 0x0075, 0x0308, 0x0304}, {0x01D7, 0x0055, 0x0308, 0x0301},
+    {0x01D8, 0x0075, 0x0308, 0x0301}, {0x01D9, 0x0055, 0x0308, 0x030C}, {0x01DA, 0x0075, 0x0308, 0x030C}, {0x01DB, 0x0055, 0x0308, 0x0300},
+    {0x01DC, 0x0075, 0x0308, 0x0300}, {0x01DE, 0x0041, 0x0308, 0x0304}, {0x01DF, 0x0061, 0x0308, 0x0304}, {0x01E0, 0x0041, 0x0307, 0x0304},
+    {0x01E1, 0x0061, 0x0307, 0x0304}, {0x01E2, 0x00C6, 0x0304, 0x0000}, {0x01E3, 0x00E6, 0x0304, 0x0000}, {0x01E6, 0x0047, 0x030C, 0x0000},
+    {0x01E7, 0x0067, 0x030C, 0x0000}, {0x01E8, 0x004B, 0x030C, 0x0000}, {0x01E9, 0x006B, 0x030C, 0x0000}, {0x01EA, 0x004F, 0x0328, 0x0000},
+    {0x01EB, 0x006F, 0x0328, 0x0000}, {0x01EC, 0x004F, 0x0328, 0x0304}, {0x01ED, 0x006F, 0x0328, 0x0304}, {0x01EE, 0x01B7, 0x030C, 0x0000},
+    {0x01EF, 0x0292, 0x030C, 0x0000}, {0x01F0, 0x006A, 0x030C, 0x0000}, {0x01F4, 0x0047, 0x0301, 0x0000}, {0x01F5, 0x0067, 0x0301, 0x0000},
+    {0x01F8, 0x004E, 0x0300, 0x0000}, {0x01F9, 0x006E, 0x0300, 0x0000}, {0x01FA, 0x0041, 0x030A, 0x0301}, {0x01FB, 0x0061, 0x030A, 0x0301},
+    {0x01FC, 0x00C6, 0x0301, 0x0000}, {0x01FD, 0x00E6, 0x0301, 0x0000}, {0x01FE, 0x00D8, 0x0301, 0x0000}, {0x01FF, 0x00F8, 0x0301, 0x0000},
+    {0x0200, 0x0041, 0x030F, 0x0000}, {0x0201, 0x0061, 0x030F, 0x0000}, {0x0202, 0x0041, 0x0311, 0x0000}, {0x0203, 0x0061, 0x0311, 0x0000},
+    {0x0204, 0x0045, 0x030F, 0x0000}, {0x0205, 0x0065, 0x030F, 0x0000}, {0x0206, 0x0045, 0x0311, 0x0000}, {0x0207, 0x0065, 0x0311, 0x0000},
+    {0x0208, 0x0049, 0x030F, 0x0000}, {0x0209, 0x0069, 0x030F, 0x0000}, {0x020A, 0x0049, 0x0311, 0x0000}, {0x020B, 0x0069, 0x0311, 0x0000},
+    {0x020C, 0x004F, 0x030F, 0x0000}, {0x020D, 0x006F, 0x030F, 0x0000}, {0x020E, 0x004F, 0x0311, 0x0000}, {0x020F, 0x006F, 0x0311, 0x0000},
+    {0x0210, 0x0052, 0x030F, 0x0000}, {0x0211, 0x0072, 0x030F, 0x0000}, {0x0212, 0x0052, 0x0311, 0x0000}, {0x0213, 0x0072, 0x0311, 0x0000},
+    {0x0214, 0x0055, 0x030F, 0x0000}, {0x0215, 0x0075, 0x030F, 0x0000}, {0x0216, 0x0055, 0x0311, 0x0000}, {0x0217, 0x0075, 0x0311, 0x0000},
+    {0x0218, 0x0053, 0x0326, 0x0000}, {0x0219, 0x0073, 0x0326, 0x0000}, {0x021A, 0x0054, 0x0326, 0x0000}, {0x021B, 0x0074, 0x0326, 0x0000},
+    {0x021E, 0x0048, 0x030C, 0x0000}, {0x021F, 0x0068, 0x030C, 0x0000}, {0x0226, 0x0041, 0x0307, 0x0000}, {0x0227, 0x0061, 0x0307, 0x0000},
+    {0x0228, 0x0045, 0x0327, 0x0000}, {0x0229, 0x0065, 0x0327, 0x0000}, {0x022A, 0x004F, 0x0308, 0x0304}, {0x022B, 0x006F, 0x0308, 0x0304},
+    {0x022C, 0x004F, 0x0303, 0x0304}, {0x022D, 0x006F, 0x0303, 0x0304}, {0x022E, 0x004F, 0x0307, 0x0000}, {0x022F, 0x006F, 0x0307, 0x0000},
+    {0x0230, 0x004F, 0x0307, 0x0304}, {0x0231, 0x006F, 0x0307, 0x0304}, {0x0232, 0x0059, 0x0304, 0x0000}, {0x0233, 0x0079, 0x0304, 0x0000},
+    {0x0385, 0x00A8, 0x0301, 0x0000}, {0x0386, 0x0391, 0x0301, 0x0000}, {0x0388, 0x0395, 0x0301, 0x0000}, {0x0389, 0x0397, 0x0301, 0x0000},
+    {0x038A, 0x0399, 0x0301, 0x0000}, {0x038C, 0x039F, 0x0301, 0x0000}, {0x038E, 0x03A5, 0x0301, 0x0000}, {0x038F, 0x03A9, 0x0301, 0x0000},
+    {0x0390, 0x03B9, 0x0308, 0x0301}, {0x03AA, 0x0399, 0x0308, 0x0000}, {0x03AB, 0x03A5, 0x0308, 0x0000}, {0x03AC, 0x03B1, 0x0301, 0x0000},
+    {0x03AD, 0x03B5, 0x0301, 0x0000}, {0x03AE, 0x03B7, 0x0301, 0x0000}, {0x03AF, 0x03B9, 0x0301, 0x0000}, {0x03B0, 0x03C5, 0x0308, 0x0301},
+    {0x03CA, 0x03B9, 0x0308, 0x0000}, {0x03CB, 0x03C5, 0x0308, 0x0000}, {0x03CC, 0x03BF, 0x0301, 0x0000}, {0x03CD, 0x03C5, 0x0301, 0x0000},
+    {0x03CE, 0x03C9, 0x0301, 0x0000}, {0x03D3, 0x03D2, 0x0301, 0x0000}, {0x03D4, 0x03D2, 0x0308, 0x0000}, {0x0400, 0x0415, 0x0300, 0x0000},
+    {0x0401, 0x0415, 0x0308, 0x0000}, {0x0403, 0x0413, 0x0301, 0x0000}, {0x0407, 0x0406, 0x0308, 0x0000}, {0x040C, 0x041A, 0x0301, 0x0000},
+    {0x040D, 0x0418, 0x0300, 0x0000}, {0x040E, 0x0423, 0x0306, 0x0000}, {0x0419, 0x0418, 0x0306, 0x0000}, {0x0439, 0x0438, 0x0306, 0x0000},
+    {0x0450, 0x0435, 0x0300, 0x0000}, {0x0451, 0x0435, 0x0308, 0x0000}, {0x0453, 0x0433, 0x0301, 0x0000}, {0x0457, 0x0456, 0x0308, 0x0000},
+    {0x045C, 0x043A, 0x0301, 0x0000}, {0x045D, 0x0438, 0x0300, 0x0000}, {0x045E, 0x0443, 0x0306, 0x0000}, {0x0476, 0x0474, 0x030F, 0x0000},
+    {0x0477, 0x0475, 0x030F, 0x0000}, {0x04C1, 0x0416, 0x0306, 0x0000}, {0x04C2, 0x0436, 0x0306, 0x0000}, {0x04D0, 0x0410, 0x0306, 0x0000},
+    {0x04D1, 0x0430, 0x0306, 0x0000}, {0x04D2, 0x0410, 0x0308, 0x0000}, {0x04D3, 0x0430, 0x0308, 0x0000}, {0x04D6, 0x0415, 0x0306, 0x0000},
+    {0x04D7, 0x0435, 0x0306, 0x0000}, {0x04DA, 0x04D8, 0x0308, 0x0000}, {0x04DB, 0x04D9, 0x0308, 0x0000}, {0x04DC, 0x0416, 0x0308, 0x0000},
+    {0x04DD, 0x0436, 0x0308, 0x0000}, {0x04DE, 0x0417, 0x0308, 0x0000}, {0x04DF, 0x0437, 0x0308, 0x0000}, {0x04E2, 0x0418, 0x0304, 0x0000},
+    {0x04E3, 0x0438, 0x0304, 0x0000}, {0x04E4, 0x0418, 0x0308, 0x0000}, {0x04E5, 0x0438, 0x0308, 0x0000}, {0x04E6, 0x041E, 0x0308, 0x0000},
+    {0x04E7, 0x043E, 0x0308, 0x0000}, {0x04EA, 0x04E8, 0x0308, 0x0000}, {0x04EB, 0x04E9, 0x0308, 0x0000}, {0x04EC, 0x042D, 0x0308, 0x0000},
+    {0x04ED, 0x044D, 0x0308, 0x0000}, {0x04EE, 0x0423, 0x0304, 0x0000}, {0x04EF, 0x0443, 0x0304, 0x0000}, {0x04F0, 0x0423, 0x0308, 0x0000},
+    {0x04F1, 0x0443, 0x0308, 0x0000}, {0x04F2, 0x0423, 0x030B, 0x0000}, {0x04F3, 0x0443, 0x030B, 0x0000}, {0x04F4, 0x0427, 0x0308, 0x0000},
+    {0x04F5, 0x0447, 0x0308, 0x0000}, {0x04F8, 0x042B, 0x0308, 0x0000}, {0x04F9, 0x044B, 0x0308, 0x0000}, {0x1E00, 0x0041, 0x0325, 0x0000},
+    {0x1E01, 0x0061, 0x0325, 0x0000}, {0x1E02, 0x0042, 0x0307, 0x0000}, {0x1E03, 0x0062, 0x0307, 0x0000}, {0x1E04, 0x0042, 0x0323, 0x0000},
+    {0x1E05, 0x0062, 0x0323, 0x0000}, {0x1E06, 0x0042, 0x0331, 0x0000}, {0x1E07, 0x0062, 0x0331, 0x0000}, {0x1E08, 0x0043, 0x0327, 0x0301},
+    {0x1E09, 0x0063, 0x0327, 0x0301}, {0x1E0A, 0x0044, 0x0307, 0x0000}, {0x1E0B, 0x0064, 0x0307, 0x0000}, {0x1E0C, 0x0044, 0x0323, 0x0000},
+    {0x1E0D, 0x0064, 0x0323, 0x0000}, {0x1E0E, 0x0044, 0x0331, 0x0000}, {0x1E0F, 0x0064, 0x0331, 0x0000}, {0x1E10, 0x0044, 0x0327, 0x0000},
+    {0x1E11, 0x0064, 0x0327, 0x0000}, {0x1E12, 0x0044, 0x032D, 0x0000}, {0x1E13, 0x0064, 0x032D, 0x0000}, {0x1E14, 0x0045, 0x0304, 0x0300},
+    {0x1E15, 0x0065, 0x0304, 0x0300}, {0x1E16, 0x0045, 0x0304, 0x0301}, {0x1E17, 0x0065, 0x0304, 0x0301}, {0x1E18, 0x0045, 0x032D, 0x0000},
+    {0x1E19, 0x0065, 0x032D, 0x0000}, {0x1E1A, 0x0045, 0x0330, 0x0000}, {0x1E1B, 0x0065, 0x0330, 0x0000}, {0x1E1C, 0x0045, 0x0327, 0x0306},
+    {0x1E1D, 0x0065, 0x0327, 0x0306}, {0x1E1E, 0x0046, 0x0307, 0x0000}, {0x1E1F, 0x0066, 0x0307, 0x0000}, {0x1E20, 0x0047, 0x0304, 0x0000},
+    {0x1E21, 0x0067, 0x0304, 0x0000}, {0x1E22, 0x0048, 0x0307, 0x0000}, {0x1E23, 0x0068, 0x0307, 0x0000}, {0x1E24, 0x0048, 0x0323, 0x0000},
+    {0x1E25, 0x0068, 0x0323, 0x0000}, {0x1E26, 0x0048, 0x0308, 0x0000}, {0x1E27, 0x0068, 0x0308, 0x0000}, {0x1E28, 0x0048, 0x0327, 0x0000},
+    {0x1E29, 0x0068, 0x0327, 0x0000}, {0x1E2A, 0x0048, 0x032E, 0x0000}, {0x1E2B, 0x0068, 0x032E, 0x0000}, {0x1E2C, 0x0049, 0x0330, 0x0000},
+    {0x1E2D, 0x0069, 0x0330, 0x0000}, {0x1E2E, 0x0049, 0x0308, 0x0301}, {0x1E2F, 0x0069, 0x0308, 0x0301}, {0x1E30, 0x004B, 0x0301, 0x0000},
+    {0x1E31, 0x006B, 0x0301, 0x0000}, {0x1E32, 0x004B, 0x0323, 0x0000}, {0x1E33, 0x006B, 0x0323, 0x0000}, {0x1E34, 0x004B, 0x0331, 0x0000},
+    {0x1E35, 0x006B, 0x0331, 0x0000}, {0x1E36, 0x004C, 0x0323, 0x0000}, {0x1E37, 0x006C, 0x0323, 0x0000}, {0x1E38, 0x004C, 0x0323, 0x0304},
+    {0x1E39, 0x006C, 0x0323, 0x0304}, {0x1E3A, 0x004C, 0x0331, 0x0000}, {0x1E3B, 0x006C, 0x0331, 0x0000}, {0x1E3C, 0x004C, 0x032D, 0x0000},
+    {0x1E3D, 0x006C, 0x032D, 0x0000}, {0x1E3E, 0x004D, 0x0301, 0x0000}, {0x1E3F, 0x006D, 0x0301, 0x0000}, {0x1E40, 0x004D, 0x0307, 0x0000},
+    {0x1E41, 0x006D, 0x0307, 0x0000}, {0x1E42, 0x004D, 0x0323, 0x0000}, {0x1E43, 0x006D, 0x0323, 0x0000}, {0x1E44, 0x004E, 0x0307, 0x0000},
+    {0x1E45, 0x006E, 0x0307, 0x0000}, {0x1E46, 0x004E, 0x0323, 0x0000}, {0x1E47, 0x006E, 0x0323, 0x0000}, {0x1E48, 0x004E, 0x0331, 0x0000},
+    {0x1E49, 0x006E, 0x0331, 0x0000}, {0x1E4A, 0x004E, 0x032D, 0x0000}, {0x1E4B, 0x006E, 0x032D, 0x0000}, {0x1E4C, 0x004F, 0x0303, 0x0301},
+    {0x1E4D, 0x006F, 0x0303, 0x0301}, {0x1E4E, 0x004F, 0x0303, 0x0308}, {0x1E4F, 0x006F, 0x0303, 0x0308}, {0x1E50, 0x004F, 0x0304, 0x0300},
+    {0x1E51, 0x006F, 0x0304, 0x0300}, {0x1E52, 0x004F, 0x0304, 0x0301}, {0x1E53, 0x006F, 0x0304, 0x0301}, {0x1E54, 0x0050, 0x0301, 0x0000},
+    {0x1E55, 0x0070, 0x0301, 0x0000}, {0x1E56, 0x0050, 0x0307, 0x0000}, {0x1E57, 0x0070, 0x0307, 0x0000}, {0x1E58, 0x0052, 0x0307, 0x0000},
+    {0x1E59, 0x0072, 0x0307, 0x0000}, {0x1E5A, 0x0052, 0x0323, 0x0000}, {0x1E5B, 0x0072, 0x0323, 0x0000}, {0x1E5C, 0x0052, 0x0323, 0x0304},
+    {0x1E5D, 0x0072, 0x0323, 0x0304}, {0x1E5E, 0x0052, 0x0331, 0x0000}, {0x1E5F, 0x0072, 0x0331, 0x0000}, {0x1E60, 0x0053, 0x0307, 0x0000},
+    {0x1E61, 0x0073, 0x0307, 0x0000}, {0x1E62, 0x0053, 0x0323, 0x0000}, {0x1E63, 0x0073, 0x0323, 0x0000}, {0x1E64, 0x0053, 0x0301, 0x0307},
+    {0x1E65, 0x0073, 0x0301, 0x0307}, {0x1E66, 0x0053, 0x030C, 0x0307}, {0x1E67, 0x0073, 0x030C, 0x0307}, {0x1E68, 0x0053, 0x0323, 0x0307},
+    {0x1E69, 0x0073, 0x0323, 0x0307}, {0x1E6A, 0x0054, 0x0307, 0x0000}, {0x1E6B, 0x0074, 0x0307, 0x0000}, {0x1E6C, 0x0054, 0x0323, 0x0000},
+    {0x1E6D, 0x0074, 0x0323, 0x0000}, {0x1E6E, 0x0054, 0x0331, 0x0000}, {0x1E6F, 0x0074, 0x0331, 0x0000}, {0x1E70, 0x0054, 0x032D, 0x0000},
+    {0x1E71, 0x0074, 0x032D, 0x0000}, {0x1E72, 0x0055, 0x0324, 0x0000}, {0x1E73, 0x0075, 0x0324, 0x0000}, {0x1E74, 0x0055, 0x0330, 0x0000},
+    {0x1E75, 0x0075, 0x0330, 0x0000}, {0x1E76, 0x0055, 0x032D, 0x0000}, {0x1E77, 0x0075, 0x032D, 0x0000}, {0x1E78, 0x0055, 0x0303, 0x0301},
+    {0x1E79, 0x0075, 0x0303, 0x0301}, {0x1E7A, 0x0055, 0x0304, 0x0308}, {0x1E7B, 0x0075, 0x0304, 0x0308}, {0x1E7C, 0x0056, 0x0303, 0x0000},
+    {0x1E7D, 0x0076, 0x0303, 0x0000}, {0x1E7E, 0x0056, 0x0323, 0x0000}, {0x1E7F, 0x0076, 0x0323, 0x0000}, {0x1E80, 0x0057, 0x0300, 0x0000},
+    {0x1E81, 0x0077, 0x0300, 0x0000}, {0x1E82, 0x0057, 0x0301, 0x0000}, {0x1E83, 0x0077, 0x0301, 0x0000}, {0x1E84, 0x0057, 0x0308, 0x0000},
+    {0x1E85, 0x0077, 0x0308, 0x0000}, {0x1E86, 0x0057, 0x0307, 0x0000}, {0x1E87, 0x0077, 0x0307, 0x0000}, {0x1E88, 0x0057, 0x0323, 0x0000},
+    {0x1E89, 0x0077, 0x0323, 0x0000}, {0x1E8A, 0x0058, 0x0307, 0x0000}, {0x1E8B, 0x0078, 0x0307, 0x0000}, {0x1E8C, 0x0058, 0x0308, 0x0000},
+    {0x1E8D, 0x0078, 0x0308, 0x0000}, {0x1E8E, 0x0059, 0x0307, 0x0000}, {0x1E8F, 0x0079, 0x0307, 0x0000}, {0x1E90, 0x005A, 0x0302, 0x0000},
+    {0x1E91, 0x007A, 0x0302, 0x0000}, {0x1E92, 0x005A, 0x0323, 0x0000}, {0x1E93, 0x007A, 0x0323, 0x0000}, {0x1E94, 0x005A, 0x0331, 0x0000},
+    {0x1E95, 0x007A, 0x0331, 0x0000}, {0x1E96, 0x0068, 0x0331, 0x0000}, {0x1E97, 0x0074, 0x0308, 0x0000}, {0x1E98, 0x0077, 0x030A, 0x0000},
+    {0x1E99, 0x0079, 0x030A, 0x0000}, {0x1E9B, 0x017F, 0x0307, 0x0000}, {0x1EA0, 0x0041, 0x0323, 0x0000}, {0x1EA1, 0x0061, 0x0323, 0x0000},
+    {0x1EA2, 0x0041, 0x0309, 0x0000}, {0x1EA3, 0x0061, 0x0309, 0x0000}, {0x1EA4, 0x0041, 0x0302, 0x0301}, {0x1EA5, 0x0061, 0x0302, 0x0301},
+    {0x1EA6, 0x0041, 0x0302, 0x0300}, {0x1EA7, 0x0061, 0x0302, 0x0300}, {0x1EA8, 0x0041, 0x0302, 0x0309}, {0x1EA9, 0x0061, 0x0302, 0x0309},
+    {0x1EAA, 0x0041, 0x0302, 0x0303}, {0x1EAB, 0x0061, 0x0302, 0x0303}, {0x1EAC, 0x0041, 0x0323, 0x0302}, {0x1EAD, 0x0061, 0x0323, 0x0302},
+    {0x1EAE, 0x0041, 0x0306, 0x0301}, {0x1EAF, 0x0061, 0x0306, 0x0301}, {0x1EB0, 0x0041, 0x0306, 0x0300}, {0x1EB1, 0x0061, 0x0306, 0x0300},
+    {0x1EB2, 0x0041, 0x0306, 0x0309}, {0x1EB3, 0x0061, 0x0306, 0x0309}, {0x1EB4, 0x0041, 0x0306, 0x0303}, {0x1EB5, 0x0061, 0x0306, 0x0303},
+    {0x1EB6, 0x0041, 0x0323, 0x0306}, {0x1EB7, 0x0061, 0x0323, 0x0306}, {0x1EB8, 0x0045, 0x0323, 0x0000}, {0x1EB9, 0x0065, 0x0323, 0x0000},
+    {0x1EBA, 0x0045, 0x0309, 0x0000}, {0x1EBB, 0x0065, 0x0309, 0x0000}, {0x1EBC, 0x0045, 0x0303, 0x0000}, {0x1EBD, 0x0065, 0x0303, 0x0000},
+    {0x1EBE, 0x0045, 0x0302, 0x0301}, {0x1EBF, 0x0065, 0x0302, 0x0301}, {0x1EC0, 0x0045, 0x0302, 0x0300}, {0x1EC1, 0x0065, 0x0302, 0x0300},
+    {0x1EC2, 0x0045, 0x0302, 0x0309}, {0x1EC3, 0x0065, 0x0302, 0x0309}, {0x1EC4, 0x0045, 0x0302, 0x0303}, {0x1EC5, 0x0065, 0x0302, 0x0303},
+    {0x1EC6, 0x0045, 0x0323, 0x0302}, {0x1EC7, 0x0065, 0x0323, 0x0302}, {0x1EC8, 0x0049, 0x0309, 0x0000}, {0x1EC9, 0x0069, 0x0309, 0x0000},
+    {0x1ECA, 0x0049, 0x0323, 0x0000}, {0x1ECB, 0x0069, 0x0323, 0x0000}, {0x1ECC, 0x004F, 0x0323, 0x0000}, {0x1ECD, 0x006F, 0x0323, 0x0000},
+    {0x1ECE, 0x004F, 0x0309, 0x0000}, {0x1ECF, 0x006F, 0x0309, 0x0000}, {0x1ED0, 0x004F, 0x0302, 0x0301}, {0x1ED1, 0x006F, 0x0302, 0x0301},
+    {0x1ED2, 0x004F, 0x0302, 0x0300}, {0x1ED3, 0x006F, 0x0302, 0x0300}, {0x1ED4, 0x004F, 0x0302, 0x0309}, {0x1ED5, 0x006F, 0x0302, 0x0309},
+    {0x1ED6, 0x004F, 0x0302, 0x0303}, {0x1ED7, 0x006F, 0x0302, 0x0303}, {0x1ED8, 0x004F, 0x0323, 0x0302}, {0x1ED9, 0x006F, 0x0323, 0x0302},
+    {0x1EDA, 0x004F, 0x031B, 0x0301}, {0x1EDB, 0x006F, 0x031B, 0x0301}, {0x1EDC, 0x004F, 0x031B, 0x0300}, {0x1EDD, 0x006F, 0x031B, 0x0300},
+    {0x1EDE, 0x004F, 0x031B, 0x0309}, {0x1EDF, 0x006F, 0x031B, 0x0309}, {0x1EE0, 0x004F, 0x031B, 0x0303}, {0x1EE1, 0x006F, 0x031B, 0x0303},
+    {0x1EE2, 0x004F, 0x031B, 0x0323}, {0x1EE3, 0x006F, 0x031B, 0x0323}, {0x1EE4, 0x0055, 0x0323, 0x0000}, {0x1EE5, 0x0075, 0x0323, 0x0000},
+    {0x1EE6, 0x0055, 0x0309, 0x0000}, {0x1EE7, 0x0075, 0x0309, 0x0000}, {0x1EE8, 0x0055, 0x031B, 0x0301}, {0x1EE9, 0x0075, 0x031B, 0x0301},
+    {0x1EEA, 0x0055, 0x031B, 0x0300}, {0x1EEB, 0x0075, 0x031B, 0x0300}, {0x1EEC, 0x0055, 0x031B, 0x0309}, {0x1EED, 0x0075, 0x031B, 0x0309},
+    {0x1EEE, 0x0055, 0x031B, 0x0303}, {0x1EEF, 0x0075, 0x031B, 0x0303}, {0x1EF0, 0x0055, 0x031B, 0x0323}, {0x1EF1, 0x0075, 0x031B, 0x0323},
+    {0x1EF2, 0x0059, 0x0300, 0x0000}, {0x1EF3, 0x0079, 0x0300, 0x0000}, {0x1EF4, 0x0059, 0x0323, 0x0000}, {0x1EF5, 0x0079, 0x0323, 0x0000},
+    {0x1EF6, 0x0059, 0x0309, 0x0000}, {0x1EF7, 0x0079, 0x0309, 0x0000}, {0x1EF8, 0x0059, 0x0303, 0x0000}, {0x1EF9, 0x0079, 0x0303, 0x0000},
+};
+
+const Decomposition* find_decomposition(uint32_t cp) {
+    const Decomposition* end = DECOMPOSITIONS + sizeof(DECOMPOSITIONS) / sizeof(Decomposition);
+    const Decomposition* it = std::lower_bound(DECOMPOSITIONS, end, cp, [](const Decomposition& d, uint32_t c) {
+        return d.cp < c;
+    });
+    if ((it != end) && (it->cp == cp)) {
+        return it;
+    }
+    return nullptr;
+}
+
+uint32_t make_primary(uint8_t group, uint32_t value) {
+    return (static_cast<uint32_t>(group) << 24) | (value & 0xFFFFFF);
+}
+
+bool is_combining_mark(uint32_t cp) {
+    return ((cp >= 0x0300) && (cp <= 0x036F)) || (cp == 0x3099) || (cp == 0x309A) ||
+        ((cp >= 0x064B) && (cp <= 0x065F)) || (cp == 0x0670) || (cp == 0x093C);
+}
+
+uint8_t get_mark_weight(uint32_t cp) {
+    if ((cp >= 0x0300) && (cp <= 0x036F)) {
+        return SECONDARY_COMBINING + (cp - 0x0300);
+    } else if (cp == 0x3099) {
+        return SECONDARY_DAKUTEN;
+    } else if (cp == 0x309A) {
+        return SECONDARY_HANDAKUTEN;
+    } else if ((cp >= 0x064B) && (cp <= 0x065F)) {
+        return SECONDARY_ARABIC_MARK + (cp - 0x064B);
+    } else if (cp == 0x0670) {
+        return SECONDARY_ARABIC_MARK + (0x0660 - 0x064B);
+    }
+    return SECONDARY_NUKTA;
+}
+
+bool is_variable(uint32_t cp) {
+    if (cp < 0x80) {
+        bool alnum = ((cp >= '0') && (cp <= '9')) || ((cp >= 'a') && (cp <= 'z')) || ((cp >= 'A') && (cp <= 'Z'));
+        return !alnum;
+    }
+    return ((cp >= 0x80) && (cp <= 0xBF)) || (cp == 0xD7) || (cp == 0xF7) || ((cp >= 0x02B0) && (cp <= 0x02FF)) ||
+        (cp == 0x037E) || (cp == 0x0387) || (cp == 0x060C) || (cp == 0x061B) || (cp == 0x061F) ||
+        ((cp >= 0x066A) && (cp <= 0x066D)) || (cp == 0x06D4) || (cp == 0x0964) || (cp == 0x0965) ||
+        ((cp >= 0x2000) && (cp <= 0x2BFF)) || ((cp >= 0x3000) && (cp <= 0x303F)) || (cp == 0x30FB);
+}
+
+// Returns the digit value, or -1 if cp isn't a decimal digit
+int get_digit_value(uint32_t cp) {
+    if ((cp >= '0') && (cp <= '9')) {
+        return cp - '0';
+    } else if ((cp >= 0x0660) && (cp <= 0x0669)) {
+        return cp - 0x0660;
+    } else if ((cp >= 0x06F0) && (cp <= 0x06F9)) {
+        return cp - 0x06F0;
+    } else if ((cp >= 0x0966) && (cp <= 0x096F)) {
+        return cp - 0x0966;
+    }
+    return -1;
+}
+
+void add_latin(std::vector<Element>& elements, uint32_t cp, uint8_t secondary, uint8_t tertiary) {
+    uint32_t lower = cp;
+    if ((cp >= 'A') && (cp <= 'Z')) {
+        lower = cp + ('a' - 'A');
+        tertiary = (tertiary == TERTIARY_LOWER) ? TERTIARY_UPPER : tertiary;
+    }
+
+    if ((lower >= 'a') && (lower <= 'z')) {
+        elements.push_back({make_primary(GROUP_LATIN, (lower - 'a' + 1) << 4), secondary, tertiary});
+    }
+}
+
+// Latin letters without a canonical decomposition, returns false if cp isn't one of them
+bool add_special_latin(std::vector<Element>& elements, uint32_t cp) {
+    switch (cp) {
+        case 0x00C6: // Æ
+        case 0x00E6: // æ
+        case 0x0152: // Œ
+        case 0x0153: // œ
+        case 0x0132: // Ĳ
+        case 0x0133: { // ĳ
+            bool upper = (cp == 0x00C6) || (cp == 0x0152) || (cp == 0x0132);
+            uint8_t tertiary = upper ? TERTIARY_EXPANSION_UPPER : TERTIARY_EXPANSION;
+            uint32_t first = ((cp == 0x00C6) || (cp == 0x00E6)) ? 'a' : (((cp == 0x0152) || (cp == 0x0153)) ? 'o' : 'i');
+            uint32_t second = ((cp == 0x0132) || (cp == 0x0133)) ? 'j' : 'e';
+            add_latin(elements, first, SECONDARY_NONE, tertiary);
+            add_latin(elements, second, SECONDARY_NONE, tertiary);
+            return true;
+        }
+        case 0x00DF: // ß
+            add_latin(elements, 's', SECONDARY_NONE, TERTIARY_EXPANSION);
+            add_latin(elements, 's', SECONDARY_NONE, TERTIARY_EXPANSION);
+            return true;
+        case 0x00D8: // Ø
+        case 0x0110: // Đ
+        case 0x0126: // Ħ
+        case 0x0141: // Ł
+            add_latin(elements, (cp == 0x00D8) ? 'O' : ((cp == 0x0110) ? 'D' : ((cp == 0x0126) ? 'H' : 'L')), SECONDARY_STROKE, TERTIARY_LOWER);
+            return true;
+        case 0x00F8: // ø
+        case 0x0111: // đ
+        case 0x0127: // ħ
+        case 0x0142: // ł
+            add_latin(elements, (cp == 0x00F8) ? 'o' : ((cp == 0x0111) ? 'd' : ((cp == 0x0127) ? 'h' : 'l')), SECONDARY_STROKE, TERTIARY_LOWER);
+            return true;
+        case 0x0131: // ı
+            add_latin(elements, 'i', SECONDARY_DOTLESS, TERTIARY_LOWER);
+            return true;
+        case 0x017F: // ſ
+            add_latin(elements, 's', SECONDARY_NONE, TERTIARY_VARIANT);
+            return true;
+        case 0x00D0: // Ð
+        case 0x00F0: // ð
+            elements.push_back({make_primary(GROUP_LATIN, (('d' - 'a' + 1) << 4) + 1), SECONDARY_NONE, (cp == 0x00D0) ? TERTIARY_UPPER : TERTIARY_LOWER});
+            return true;
+        case 0x014A: // Ŋ
+        case 0x014B: // ŋ
+            elements.push_back({make_primary(GROUP_LATIN, (('n' - 'a' + 1) << 4) + 1), SECONDARY_NONE, (cp == 0x014A) ? TERTIARY_UPPER : TERTIARY_LOWER});
+            return true;
+        case 0x00DE: // Þ
+        case 0x00FE: // þ
+            elements.push_back({make_primary(GROUP_LATIN, (('z' - 'a' + 1) << 4) + 1), SECONDARY_NONE, (cp == 0x00DE) ? TERTIARY_UPPER : TERTIARY_LOWER});
+            return true;
+        default:
+            return false;
+    }
+}
+
+void add_greek(std::vector<Element>& elements, uint32_t cp) {
+    uint8_t tertiary = TERTIARY_LOWER;
+    if ((cp >= 0x0391) && (cp <= 0x03A9)) {
+        cp += 0x20;
+        tertiary = TERTIARY_UPPER;
+    } else if (cp == 0x03C2) { // final sigma
+        cp = 0x03C3;
+        tertiary = TERTIARY_VARIANT;
+    }
+    elements.push_back({make_primary(GROUP_GREEK, cp), SECONDARY_NONE, tertiary});
+}
+
+void add_cyrillic(std::vector<Element>& elements, uint32_t cp) {
+    uint8_t tertiary = TERTIARY_LOWER;
+    if ((cp >= 0x0410) && (cp <= 0x042F)) {
+        cp += 0x20;
+        tertiary = TERTIARY_UPPER;
+    } else if ((cp >= 0x0400) && (cp <= 0x040F)) {
+        cp += 0x50;
+        tertiary = TERTIARY_UPPER;
+    } else if (cp == 0x04C0) {
+        cp = 0x04CF;
+        tertiary = TERTIARY_UPPER;
+    } else if ((cp >= 0x04C1) && (cp <= 0x04CE)) {
+        if (cp % 2 == 1) {
+            cp++;
+            tertiary = TERTIARY_UPPER;
+        }
+    } else if ((cp >= 0x0460) && (cp <= 0x052F) && (cp != 0x04CF)) {
+        if (cp % 2 == 0) {
+            cp++;
+            tertiary = TERTIARY_UPPER;
+        }
+    }
+
+    // Code point order is alphabetical for the basic letters, a few others are moved next to their relatives
+    uint32_t value = cp << 4;
+    if (cp == 0x0439) { // й right after и
+        value = (0x0438 << 4) + 1;
+    } else if (cp == 0x0456) { // і after и and й
+        value = (0x0438 << 4) + 2;
+    } else if (cp == 0x0454) { // є after е
+        value = (0x0435 << 4) + 1;
+    } else if (cp == 0x0491) { // ґ after г
+        value = (0x0433 << 4) + 1;
+    }
+    elements.push_back({make_primary(GROUP_CYRILLIC, value), SECONDARY_NONE, tertiary});
+}
+
+void add_kana(std::vector<Element>& elements, uint32_t cp) {
+    uint8_t tertiary = TERTIARY_LOWER;
+    uint8_t secondary = SECONDARY_NONE;
+
+    // Katakana sorts with the matching hiragana
+    if ((cp >= 0x30A1) && (cp <= 0x30F6)) {
+        cp -= 0x60;
+        tertiary = TERTIARY_VARIANT;
+    }
+
+    if ((cp >= 0x304C) && (cp <= 0x3062) && (cp % 2 == 0)) { // が to ぢ
+        cp--;
+        secondary = SECONDARY_DAKUTEN;
+    } else if ((cp >= 0x3065) && (cp <= 0x3069) && (cp % 2 == 1)) { // づ, で, ど
+        cp--;
+        secondary = SECONDARY_DAKUTEN;
+    } else if ((cp >= 0x3070) && (cp <= 0x307D) && ((cp - 0x306F) % 3 != 0)) { // ば to ぽ
+        secondary = ((cp - 0x306F) % 3 == 1) ? SECONDARY_DAKUTEN : SECONDARY_HANDAKUTEN;
+        cp -= (cp - 0x306F) % 3;
+    } else if (cp == 0x3094) { // ゔ
+        cp = 0x3046;
+        secondary = SECONDARY_DAKUTEN;
+    } else if ((cp == 0x3041) || (cp == 0x3043) || (cp == 0x3045) || (cp == 0x3047) || (cp == 0x3049) ||
+               (cp == 0x3063) || (cp == 0x3083) || (cp == 0x3085) || (cp == 0x3087) || (cp == 0x308E)) {
+        cp++;
+        tertiary = TERTIARY_SMALL;
+    } else if (cp == 0x3095) { // ゕ
+        cp = 0x304B;
+        tertiary = TERTIARY_SMALL;
+    } else if (cp == 0x3096) { // ゖ
+        cp = 0x3051;
+        tertiary = TERTIARY_SMALL;
+    }
+    elements.push_back({make_primary(GROUP_KANA, cp), secondary, tertiary});
+}
+
+// Adds the collation elements of a code point that has no decomposition
+void add_base(std::vector<Element>& elements, uint32_t cp) {
+    if (is_combining_mark(cp)) {
+        elements.push_back({0, get_mark_weight(cp), 0});
+        return;
+    }
+
+    if (cp == 0x0640) { // Arabic tatweel only stretches the text
+        return;
+    }
+
+    if (is_variable(cp)) {
+        elements.push_back({make_primary(GROUP_VARIABLE, cp), SECONDARY_NONE, TERTIARY_LOWER});
+        return;
+    }
+
+    int digit = get_digit_value(cp);
+    if (digit >= 0) {
+        elements.push_back({make_primary(GROUP_DIGIT, digit), SECONDARY_NONE, TERTIARY_LOWER});
+        return;
+    }
+
+    if (cp < 0x80) {
+        add_latin(elements, cp, SECONDARY_NONE, TERTIARY_LOWER);
+    } else if (((cp >= 0x00C0) && (cp <= 0x024F)) || ((cp >= 0x1E00) && (cp <= 0x1EFF))) {
+        if (!add_special_latin(elements, cp)) {
+            // Remaining Latin letters sort after z in code point order
+            elements.push_back({make_primary(GROUP_LATIN, 0x1000 + cp), SECONDARY_NONE, TERTIARY_LOWER});
+        }
+    } else if ((cp >= 0x0370) && (cp <= 0x03FF)) {
+        add_greek(elements, cp);
+    } else if ((cp >= 0x0400) && (cp <= 0x052F)) {
+        add_cyrillic(elements, cp);
+    } else if (((cp >= 0x0600) && (cp <= 0x06FF)) || ((cp >= 0x0750) && (cp <= 0x077F))) {
+        elements.push_back({make_primary(GROUP_ARABIC, cp), SECONDARY_NONE, TERTIARY_LOWER});
+    } else if ((cp >= 0x0900) && (cp <= 0x097F)) {
+        elements.push_back({make_primary(GROUP_DEVANAGARI, cp), SECONDARY_NONE, TERTIARY_LOWER});
+    } else if ((cp >= 0x3040) && (cp <= 0x30FF)) {
+        add_kana(elements, cp);
+    } else {
+        elements.push_back({make_primary(GROUP_OTHER, cp), SECONDARY_NONE, TERTIARY_LOWER});
+    }
+}
+
+void add_code_point(std::vector<Element>& elements, uint32_t cp) {
+    // й is a letter of its own rather than и with a breve
+    const Decomposition* d = ((cp == 0x0419) || (cp == 0x0439)) ? nullptr : find_decomposition(cp);
+    if (d == nullptr) {
+        add_base(elements, cp);
+        return;
+    }
+
+    add_base(elements, d->base);
+    add_base(elements, d->mark1);
+    if (d->mark2 != 0) {
+        add_base(elements, d->mark2);
+    }
+}
+
+} // namespace
+
+std::string Collation::get_sort_key(std::string_view s, Mode mode) {
+    if (mode == CODEPOINT) {
+        return std::string(s); // UTF-8 byte order is code point order
+    }
+
+    std::vector<Element> elements;
+    elements.reserve(s.size());
+    size_t i = 0;
+    while (i < s.size()) {
+        add_code_point(elements, next_code_point(s, i));
+    }
+
+    std::string key;
+    key.reserve(elements.size() * 6 + s.size() + 3);
+
+    for (const Element& e : elements) {
+        if (e.primary != 0) {
+            key += static_cast<char>(e.primary >> 24);
+            key += static_cast<char>((e.primary >> 16) & 0xFF);
+            key += static_cast<char>((e.primary >> 8) & 0xFF);
+            key += static_cast<char>(e.primary & 0xFF);
+        }
+    }
+    key += '\0';
+
+    for (const Element& e : elements) {
+        if (e.secondary != 0) {
+            key += static_cast<char>(e.secondary);
+        }
+    }
+    key += '\0';
+
+    for (const Element& e : elements) {
+        if (e.tertiary != 0) {
+            key += static_cast<char>(e.tertiary);
+        }
+    }
+    key += '\0';
+
+    key += s;
+    return key;
+}
+
+bool Collation::get_mode(const std::string& name, Mode& mode) {
+    if (name.empty() || (name == "root")) {
+        mode = ROOT;
+        return true;
+    } else if (name == "codepoint") {
+        mode = CODEPOINT;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,316 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/docx_stream.h"
+#include "include/utf8.h"
+#include "../docx/docx.hpp" // for the ScriptAnalyzer typefaces
+
+// Standard includes
+#include <cstdio> // for snprintf
+#include <stdexcept>
+#include <utility> // for move
+
+// document.xml is handed to the compressor in pieces of about this size
+const size_t DOCX_STREAM_BUFFER_SIZE = 1 << 16;
+
+namespace {
+
+// Arena of the calling thread, null for the heap
+thread_local std::pmr::memory_resource* current_arena = nullptr;
+
+std::pmr::memory_resource* get_resource() {
+    return (current_arena != nullptr) ? current_arena : std::pmr::new_delete_resource();
+}
+
+const char* CONTENT_TYPES_XML =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+    "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+    "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+    "<Override PartName=\"/word/document.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml\"/>"
+    "<Override PartName=\"/word/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.wordprocessingml.styles+xml\"/>"
+    "</Types>";
+
+const char* PACKAGE_RELS_XML =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"word/document.xml\"/>"
+    "</Relationships>";
+
+const char* DOCUMENT_RELS_XML =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" Target=\"styles.xml\"/>"
+    "</Relationships>";
+
+const char* DOCUMENT_BEGIN_XML =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<w:document xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\"><w:body>";
+
+// A4 with 2.5 cm margins
+const char* DOCUMENT_END_XML =
+    "<w:sectPr><w:pgSz w:w=\"11906\" w:h=\"16838\"/>"
+    "<w:pgMar w:top=\"1417\" w:right=\"1417\" w:bottom=\"1417\" w:left=\"1417\" w:header=\"708\" w:footer=\"708\" w:gutter=\"0\"/>"
+    "</w:sectPr></w:body></w:document>";
+
+enum Script {
+    NEUTRAL, // takes the script of the text around it
+    LATIN,
+    GREEK,
+    CYRILLIC,
+    ARABIC,
+    DEVANAGARI,
+    JAPANESE
+};
+
+// ASCII punctuation, digits and spaces count as Latin, matching
+// ScriptAnalyzer::set_force_use_latin_typeface_for_latin_punctuation(true) which Adict always sets
+Script get_script(uint32_t cp) {
+    if (cp < 0x80) {
+        return LATIN;
+    } else if ((cp >= 0x0370 && cp <= 0x03FF) || (cp >= 0x1F00 && cp <= 0x1FFF)) {
+        return GREEK;
+    } else if (cp >= 0x0400 && cp <= 0x052F) {
+        return CYRILLIC;
+    } else if ((cp >= 0x0600 && cp <= 0x06FF) || (cp >= 0x0750 && cp <= 0x077F) || (cp >= 0xFB50 && cp <= 0xFDFF) || (cp >= 0xFE70 && cp <= 0xFEFF)) {
+        return ARABIC;
+    } else if (cp >= 0x0900 && cp <= 0x097F) {
+        return DEVANAGARI;
+    } else if ((cp >= 0x3040 && cp <= 0x30FF) || (cp >= 0x3400 && cp <= 0x4DBF) || (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0xFF00 && cp <= 0xFFEF)) {
+        return JAPANESE;
+    } else if ((cp >= 0x2000 && cp <= 0x206F) || (cp >= 0x3000 && cp <= 0x303F) || (cp >= 0x0300 && cp <= 0x036F)) {
+        return NEUTRAL; // general punctuation, CJK punctuation, combining marks
+    }
+    return LATIN;
+}
+
+std::string_view get_typeface(Script script) {
+    switch (script) {
+        case GREEK:
+            return ScriptAnalyzer::greek_typeface;
+        case CYRILLIC:
+            return ScriptAnalyzer::cyrillic_typeface;
+        case ARABIC:
+            return ScriptAnalyzer::arabic_typeface;
+        case DEVANAGARI:
+            return ScriptAnalyzer::devanagari_typeface;
+        case JAPANESE:
+            return ScriptAnalyzer::japanese_typeface;
+        default:
+            return ScriptAnalyzer::latin_typeface;
+    }
+}
+
+void append_escaped(std::string& out, std::string_view s) {
+    for (char c : s) {
+        switch (c) {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            default:
+                // Control characters other than tab and line breaks aren't allowed in XML
+                if ((static_cast<unsigned char>(c) >= 0x20) || (c == '\t') || (c == '\n') || (c == '\r')) {
+                    out += c;
+                }
+        }
+    }
+}
+
+} // namespace
+
+// Arena
+
+DocxStream::Arena::Arena(size_t initial_size) : initial_block(new std::byte[initial_size]), resource(initial_block.get(), initial_size) {}
+
+void DocxStream::Arena::release() {
+    resource.release();
+}
+
+DocxStream::Arena::Use::Use(Arena& arena) : previous(current_arena) {
+    current_arena = &arena.resource;
+}
+
+DocxStream::Arena::Use::~Use() {
+    current_arena = previous;
+}
+
+// Text and Paragraph
+
+DocxStream::Text::Text(std::string_view content) : content(content, get_resource()), typeface(get_resource()) {}
+
+DocxStream::Text::Text(const Text& other) : content(other.content, get_resource()), typeface(other.typeface, get_resource()),
+    size(other.size), bold(other.bold), italic(other.italic) {}
+
+DocxStream::Paragraph::Paragraph() : texts(get_resource()) {}
+
+DocxStream::Paragraph::Paragraph(const Paragraph& other) : align(other.align), texts(other.texts, get_resource()) {}
+
+void DocxStream::Paragraph::add_text(Text t) {
+    texts.push_back(std::move(t));
+}
+
+void DocxStream::Paragraph::add_bold_text(std::string_view s) {
+    Text t(s);
+    t.bold = true;
+    texts.push_back(std::move(t));
+}
+
+void DocxStream::Paragraph::add_plain_text(std::string_view s) {
+    texts.emplace_back(s);
+}
+
+void DocxStream::Paragraph::add_space(size_t count, size_t size) {
+    Text t;
+    t.content.assign(count, ' ');
+    t.size = size;
+    texts.push_back(std::move(t));
+}
+
+// Methods
+
+DocxStream::DocxStream(const std::string& fpath, size_t global_font_size) : zip(fpath), global_font_size(global_font_size) {
+    if (!zip.is_open()) {
+        throw std::runtime_error("Could not open " + fpath + " for writing");
+    }
+
+    zip.begin_entry("[Content_Types].xml");
+    zip.write(CONTENT_TYPES_XML);
+    zip.begin_entry("_rels/.rels");
+    zip.write(PACKAGE_RELS_XML);
+    zip.begin_entry("word/_rels/document.xml.rels");
+    zip.write(DOCUMENT_RELS_XML);
+
+    std::string styles =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<w:styles xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\">"
+        "<w:docDefaults><w:rPrDefault><w:rPr><w:rFonts w:ascii=\"";
+    append_escaped(styles, ScriptAnalyzer::latin_typeface);
+    styles += "\" w:hAnsi=\"";
+    append_escaped(styles, ScriptAnalyzer::latin_typeface);
+    styles += "\"/><w:sz w:val=\"" + std::to_string(global_font_size * 2) + "\"/>"
+        "<w:szCs w:val=\"" + std::to_string(global_font_size * 2) + "\"/>"
+        "</w:rPr></w:rPrDefault></w:docDefaults></w:styles>";
+    zip.begin_entry("word/styles.xml");
+    zip.write(styles);
+
+    zip.begin_entry("word/document.xml");
+    buf.reserve(DOCX_STREAM_BUFFER_SIZE + DOCX_STREAM_BUFFER_SIZE / 4);
+    buf += DOCUMENT_BEGIN_XML;
+}
+
+size_t DocxStream::get_global_font_size() const {
+    return global_font_size;
+}
+
+void DocxStream::add_paragraph(const Paragraph& p) {
+    buf += "<w:p>";
+    if (p.align == Paragraph::CENTER) {
+        buf += "<w:pPr><w:jc w:val=\"center\"/></w:pPr>";
+    }
+
+    // One run per stretch of a single script, neutral characters join the stretch they are in
+    for (const Text& t : p.texts) {
+        std::string_view s = t.content;
+        size_t run_begin = 0;
+        Script run_script = NEUTRAL;
+        size_t i = 0;
+        while (i < s.size()) {
+            size_t cp_begin = i;
+            Script script = get_script(next_code_point(s, i));
+            if ((script == NEUTRAL) || (script == run_script)) {
+                continue;
+            }
+            if ((run_script != NEUTRAL) && (cp_begin > run_begin)) {
+                add_run(t, s.substr(run_begin, cp_begin - run_begin), t.typeface.empty() ? get_typeface(run_script) : std::string_view(t.typeface), run_script == ARABIC);
+                run_begin = cp_begin;
+            }
+            run_script = script;
+        }
+        if ((s.size() > run_begin) || s.empty()) {
+            Script script = (run_script == NEUTRAL) ? LATIN : run_script;
+            add_run(t, s.substr(run_begin), t.typeface.empty() ? get_typeface(script) : std::string_view(t.typeface), script == ARABIC);
+        }
+    }
+
+    buf += "</w:p>";
+    flush_if_full();
+}
+
+void DocxStream::add_empty_line(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        buf += "<w:p/>";
+    }
+    flush_if_full();
+}
+
+void DocxStream::close() {
+    buf += DOCUMENT_END_XML;
+    zip.write(buf);
+    buf.clear();
+    zip.close();
+}
+
+// Helpers
+
+void DocxStream::add_run(const Text& t, std::string_view content, std::string_view typeface, bool rtl) {
+    buf += "<w:r><w:rPr>";
+    if (!typeface.empty()) {
+        buf += "<w:rFonts w:ascii=\"";
+        append_escaped(buf, typeface);
+        buf += "\" w:hAnsi=\"";
+        append_escaped(buf, typeface);
+        buf += "\" w:eastAsia=\"";
+        append_escaped(buf, typeface);
+        buf += "\" w:cs=\"";
+        append_escaped(buf, typeface);
+        buf += "\"/>";
+    }
+    if (t.bold) {
+        buf += "<w:b/><w:bCs/>";
+    }
+    if (t.italic) {
+        buf += "<w:i/><w:iCs/>";
+    }
+    if (t.size > 0) {
+        // Appended piece by piece, concatenating first would allocate for every run
+        char half_points[24];
+        int n = std::snprintf(half_points, sizeof(half_points), "%zu", t.size * 2);
+        buf += "<w:sz w:val=\"";
+        buf.append(half_points, n);
+        buf += "\"/><w:szCs w:val=\"";
+        buf.append(half_points, n);
+        buf += "\"/>";
+    }
+    if (rtl) {
+        buf += "<w:rtl/>";
+    }
+    buf += "</w:rPr><w:t xml:space=\"preserve\">";
+    append_escaped(buf, content);
+    buf += "</w:t></w:r>";
+}
+
+void DocxStream::flush_if_full() {
+    if (buf.size() >= DOCX_STREAM_BUFFER_SIZE) {
+        zip.write(buf);
+        buf.clear();
+    }
+}
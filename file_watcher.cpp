@@ -0,0 +1,125 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/file_watcher.h"
+
+// System includes
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Standard includes
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+
+FileWatcher::FileWatcher(const std::string& fpath) {
+    std::filesystem::path p(fpath);
+    name = p.filename().string();
+    std::string dir = p.parent_path().string();
+    if (dir.empty()) {
+        dir = ".";
+    }
+
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool FileWatcher::is_open() const {
+    return fd >= 0;
+}
+
+void FileWatcher::stop() {
+    // Removing the watch queues an IN_IGNORED event, which read_events takes as the end of watching
+    if (wd >= 0) {
+        inotify_rm_watch(fd, wd);
+    }
+}
+
+bool FileWatcher::wait_for_change(int debounce_ms) {
+    if (fd < 0) {
+        return false;
+    }
+
+    // Wait for the first change
+    bool changed = false;
+    while (!changed) {
+        if (!read_events(changed)) {
+            return false;
+        }
+    }
+
+    // Then for things to settle down. Only changes to the file itself restart the quiet time, events for other files
+    // in the directory (including the ones written next to the JSON) don't.
+    auto quiet_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(debounce_ms);
+    while (true) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(quiet_until - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return true;
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int r = poll(&pfd, 1, static_cast<int>(left.count()));
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (r == 0) {
+            return true;
+        }
+
+        if (!read_events(changed)) {
+            return false;
+        }
+        if (changed) {
+            quiet_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(debounce_ms);
+        }
+    }
+}
+
+bool FileWatcher::read_events(bool& changed) {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len < 0) {
+        return errno == EINTR;
+    }
+
+    changed = false;
+    for (char* ptr = buf; ptr < buf + len;) {
+        struct inotify_event* ev = reinterpret_cast<struct inotify_event*>(ptr);
+        if (ev->mask & IN_IGNORED) {
+            return false; // stopped, or the directory is gone
+        }
+        if ((ev->len > 0) && (name == ev->name)) {
+            changed = true;
+        }
+        ptr += sizeof(struct inotify_event) + ev->len;
+    }
+    return true;
+}
@@ -0,0 +1,518 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Trie block (.adicttrie) layout, all integers in native byte order:
+
+    TrieHeader
+    Node nodes[node_count]                     the root first, children of a node next to each other
+    Entry entries[entry_count]                 one per word, by name
+    uint32_t category_offsets[category_count+1]  category i is names[offsets[i], offsets[i+1])
+    char names[names_size]                     the names in entry order (equal names once), then the categories
+*/
+
+// Program includes
+#include "include/headword_trie.h"
+#include "include/word_sort.h"
+#include "include/utf8.h"
+#include "include/stats.h"
+
+// Standard includes
+#include <algorithm> // for lower_bound, min and sort
+#include <cstring> // for memcmp and memcpy
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility> // for move
+
+namespace {
+
+const char TRIE_MAGIC[8] = {'A', 'D', 'I', 'C', 'T', 'T', 'R', 'I'};
+const uint32_t TRIE_VERSION = 2;
+const uint32_t TRIE_BYTE_ORDER = 0x01020304;
+
+struct TrieHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime; // nanoseconds
+    uint64_t source_hash;
+    uint64_t node_count;
+    uint64_t entry_count;
+    uint64_t category_count;
+    uint64_t names_size;
+};
+
+std::vector<uint32_t> decode(std::string_view s) {
+    std::vector<uint32_t> code_points;
+    size_t i = 0;
+    while (i < s.size()) {
+        code_points.push_back(next_code_point(s, i));
+    }
+    return code_points;
+}
+
+// Fills row i of the edit distance table between a name and the query q (the distances from the name's first i
+// characters to each prefix of q) from the rows before it. c is the name's i-th character, c_prev the one before it
+// and prev2 the row before prev, both only when i > 1. Returns the smallest distance in the row, which no later row
+// goes below.
+uint32_t fill_row(const std::vector<uint32_t>& q, const uint32_t* prev2, const uint32_t* prev, uint32_t* row, uint32_t c, uint32_t c_prev) {
+    row[0] = prev[0] + 1;
+    uint32_t smallest = row[0];
+    for (size_t j = 1; j <= q.size(); j++) {
+        uint32_t v = std::min(std::min(prev[j], row[j - 1]) + 1, prev[j - 1] + ((q[j - 1] == c) ? 0 : 1));
+        if ((prev2 != nullptr) && (j > 1) && (q[j - 1] == c_prev) && (q[j - 2] == c)) {
+            v = std::min(v, prev2[j - 2] + 1);
+        }
+        row[j] = v;
+        smallest = std::min(smallest, v);
+    }
+    return smallest;
+}
+
+} // namespace
+
+struct HeadwordTrie::FuzzySearch {
+    std::vector<uint32_t> query; // code points
+    size_t max_distance;
+    std::vector<uint32_t> rows; // row d of the table (for the first d characters of the name) starts at d * (query.size() + 1)
+    std::vector<uint32_t> path; // characters of the name being visited
+    std::vector<std::pair<uint32_t, uint32_t>> found; // distance, entry
+};
+
+// Building
+
+HeadwordTrie HeadwordTrie::build(const Adict& adict) {
+    STATS_SCOPE("trie/build");
+
+    // Every word once, in words_by_category order so that equal names keep it
+    std::vector<std::string_view> keys;
+    std::vector<Entry> unsorted;
+    std::vector<std::string_view> categories;
+    for (const auto& [category, ids] : adict.words_by_category) {
+        for (size_t w_i = 0; w_i < ids.size(); w_i++) {
+            keys.push_back(adict.words.get_name(ids[w_i]));
+            unsorted.push_back(Entry{0, 0, static_cast<uint32_t>(categories.size()), static_cast<uint32_t>(w_i)});
+        }
+        categories.push_back(category);
+    }
+
+    std::string blob;
+    std::vector<Entry> sorted;
+    sorted.reserve(keys.size());
+    std::string_view prev;
+    for (size_t i : sort_word_indices(keys)) {
+        Entry e = unsorted[i];
+        if (sorted.empty() || (keys[i] != prev)) {
+            if (blob.size() + keys[i].size() > std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("Dictionary text over 4 GiB");
+            }
+            e.name_offset = blob.size();
+            blob += keys[i];
+        } else {
+            e.name_offset = sorted.back().name_offset;
+        }
+        e.name_size = keys[i].size();
+        sorted.push_back(e);
+        prev = keys[i];
+    }
+
+    std::vector<uint32_t> category_offsets{static_cast<uint32_t>(blob.size())};
+    for (std::string_view c : categories) {
+        blob += c;
+        category_offsets.push_back(blob.size());
+    }
+
+    auto get_key = [&blob, &sorted](size_t e) {
+        return std::string_view(blob.data() + sorted[e].name_offset, sorted[e].name_size);
+    };
+
+    // Each node is split into children by the byte that follows the names it ends, a child's label running up to where
+    // its names stop sharing bytes. Children are added next to each other when their parent is reached.
+    struct Pending {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+        size_t depth;
+    };
+    std::vector<Node> nodes(1, Node{0, 0, 0, 0, 0, 0, static_cast<uint32_t>(sorted.size())});
+    std::vector<Pending> pending{{0, 0, static_cast<uint32_t>(sorted.size()), 0}};
+    while (!pending.empty()) {
+        Pending p = pending.back();
+        pending.pop_back();
+
+        uint32_t e = p.begin;
+        while ((e < p.end) && (get_key(e).size() == p.depth)) {
+            e++;
+        }
+        nodes[p.node].exact_count = e - p.begin;
+        nodes[p.node].first_child = nodes.size();
+
+        while (e < p.end) {
+            uint32_t group_begin = e;
+            char b = get_key(e)[p.depth];
+            while ((e < p.end) && (get_key(e)[p.depth] == b)) {
+                e++;
+            }
+
+            // The names are sorted, so the first and last of the group share as much as all of them do
+            std::string_view first = get_key(group_begin);
+            std::string_view last = get_key(e - 1);
+            size_t lcp = p.depth + 1;
+            while ((lcp < first.size()) && (lcp < last.size()) && (first[lcp] == last[lcp])) {
+                lcp++;
+            }
+
+            uint32_t child = nodes.size();
+            nodes.push_back(Node{static_cast<uint32_t>(sorted[group_begin].name_offset + p.depth), static_cast<uint32_t>(lcp - p.depth), 0, 0, group_begin, 0, e});
+            pending.push_back(Pending{child, group_begin, e, lcp});
+        }
+        nodes[p.node].child_count = nodes.size() - nodes[p.node].first_child;
+    }
+
+    TrieHeader header = {};
+    std::memcpy(header.magic, TRIE_MAGIC, sizeof(TRIE_MAGIC));
+    header.version = TRIE_VERSION;
+    header.byte_order = TRIE_BYTE_ORDER;
+    header.node_count = nodes.size();
+    header.entry_count = sorted.size();
+    header.category_count = categories.size();
+    header.names_size = blob.size();
+
+    HeadwordTrie trie;
+    std::vector<char>& block = trie.owned;
+    block.reserve(sizeof(TrieHeader) + nodes.size() * sizeof(Node) + sorted.size() * sizeof(Entry) + category_offsets.size() * sizeof(uint32_t) + blob.size());
+    auto append = [&block](const void* data, size_t size) {
+        block.insert(block.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    append(&header, sizeof(TrieHeader));
+    append(nodes.data(), nodes.size() * sizeof(Node));
+    append(sorted.data(), sorted.size() * sizeof(Entry));
+    append(category_offsets.data(), category_offsets.size() * sizeof(uint32_t));
+    append(blob.data(), blob.size());
+    trie.attach(block.data(), block.size());
+    return trie;
+}
+
+// Files
+
+HeadwordTrie HeadwordTrie::load(std::string fpath) {
+    HeadwordTrie trie;
+    if (open(fpath, trie)) {
+        return trie;
+    }
+
+    // Key the trie before reading so that an edit made meanwhile leaves it stale
+    Adict::CacheKey key;
+    bool key_ok = Adict::get_cache_key(fpath, key);
+    trie = build(Adict::load(fpath));
+    if (key_ok) {
+        trie.save(fpath, key);
+    }
+    return trie;
+}
+
+std::string HeadwordTrie::get_trie_path(std::string fpath) {
+    return Adict::get_derived_path(fpath, ".adicttrie");
+}
+
+bool HeadwordTrie::open(std::string fpath, HeadwordTrie& trie) {
+    STATS_SCOPE("trie/open");
+    std::unique_ptr<MappedFile> mf = std::make_unique<MappedFile>(get_trie_path(fpath));
+    if (!mf->is_open() || (mf->size() < sizeof(TrieHeader))) {
+        return false;
+    }
+
+    TrieHeader header;
+    std::memcpy(&header, mf->data(), sizeof(TrieHeader));
+    Adict::CacheKey key;
+    key.size = header.source_size;
+    key.mtime = header.source_mtime;
+    key.hash = header.source_hash;
+    if (!Adict::is_source_unchanged(fpath, key, get_trie_path(fpath))) {
+        return false;
+    }
+
+    HeadwordTrie result;
+    if (!result.attach(mf->data(), mf->size())) {
+        return false;
+    }
+    result.mapped = std::move(mf);
+    trie = std::move(result);
+    return true;
+}
+
+void HeadwordTrie::save(std::string fpath, const Adict::CacheKey& key) const {
+    TrieHeader header;
+    std::memcpy(&header, owned.data(), sizeof(TrieHeader));
+    header.source_size = key.size;
+    header.source_mtime = key.mtime;
+    header.source_hash = key.hash;
+
+    Adict::write_derived_file(get_trie_path(fpath), {
+        std::string_view(reinterpret_cast<const char*>(&header), sizeof(TrieHeader)),
+        std::string_view(owned.data() + sizeof(TrieHeader), owned.size() - sizeof(TrieHeader))
+    }, "trie");
+}
+
+bool HeadwordTrie::attach(const char* data, size_t size) {
+    TrieHeader header;
+    std::memcpy(&header, data, sizeof(TrieHeader));
+    if ((std::memcmp(header.magic, TRIE_MAGIC, sizeof(TRIE_MAGIC)) != 0) || (header.version != TRIE_VERSION) || (header.byte_order != TRIE_BYTE_ORDER)) {
+        return false;
+    }
+
+    uint64_t body_size = size - sizeof(TrieHeader);
+    if ((header.node_count == 0) || (header.node_count > body_size / sizeof(Node)) || (header.entry_count > body_size / sizeof(Entry)) ||
+        (header.category_count >= body_size / 4) || (header.names_size > body_size) ||
+        (header.node_count * sizeof(Node) + header.entry_count * sizeof(Entry) + (header.category_count + 1) * 4 + header.names_size != body_size)) {
+        return false;
+    }
+
+    const Node* n = reinterpret_cast<const Node*>(data + sizeof(TrieHeader));
+    const Entry* e = reinterpret_cast<const Entry*>(n + header.node_count);
+    const uint32_t* c = reinterpret_cast<const uint32_t*>(e + header.entry_count);
+    const char* s = reinterpret_cast<const char*>(c + header.category_count + 1);
+
+    // Everything is checked once here so lookups don't have to. Children come after their parent, so descents end.
+    for (uint64_t i = 0; i < header.node_count; i++) {
+        const Node& node = n[i];
+        if ((static_cast<uint64_t>(node.label_offset) + node.label_size > header.names_size) || ((i > 0) && (node.label_size == 0)) ||
+            ((node.child_count > 0) && (node.first_child <= i)) || (static_cast<uint64_t>(node.first_child) + node.child_count > header.node_count) ||
+            (node.entry_begin > node.entry_end) || (node.entry_end > header.entry_count) || (node.exact_count > node.entry_end - node.entry_begin)) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        if ((static_cast<uint64_t>(e[i].name_offset) + e[i].name_size > header.names_size) || (e[i].category >= header.category_count)) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.category_count; i++) {
+        if ((c[i] > c[i + 1]) || (c[i + 1] > header.names_size)) {
+            return false;
+        }
+    }
+
+    nodes = n;
+    entries = e;
+    category_offsets = c;
+    names = s;
+    node_count = header.node_count;
+    entry_count = header.entry_count;
+    category_count = header.category_count;
+    names_size = header.names_size;
+    return true;
+}
+
+// Lookups
+
+std::vector<HeadwordTrie::Match> HeadwordTrie::find(std::string_view name) const {
+    uint32_t node;
+    size_t depth;
+    std::vector<Match> matches;
+    if (!descend(name, node, depth) || (depth != name.size())) {
+        return matches;
+    }
+
+    matches.reserve(nodes[node].exact_count);
+    for (uint32_t e = nodes[node].entry_begin; e < nodes[node].entry_begin + nodes[node].exact_count; e++) {
+        matches.push_back(get_match(e));
+    }
+    return matches;
+}
+
+std::vector<HeadwordTrie::Match> HeadwordTrie::find_prefix(std::string_view prefix, size_t limit) const {
+    uint32_t node;
+    size_t depth;
+    std::vector<Match> matches;
+    if (!descend(prefix, node, depth)) {
+        return matches;
+    }
+
+    uint32_t end = nodes[node].entry_end;
+    if ((limit > 0) && (limit < end - nodes[node].entry_begin)) {
+        end = nodes[node].entry_begin + limit;
+    }
+    matches.reserve(end - nodes[node].entry_begin);
+    for (uint32_t e = nodes[node].entry_begin; e < end; e++) {
+        matches.push_back(get_match(e));
+    }
+    return matches;
+}
+
+size_t HeadwordTrie::count_prefix(std::string_view prefix) const {
+    uint32_t node;
+    size_t depth;
+    if (!descend(prefix, node, depth)) {
+        return 0;
+    }
+    return nodes[node].entry_end - nodes[node].entry_begin;
+}
+
+std::vector<HeadwordTrie::Match> HeadwordTrie::complete(std::string_view prefix, size_t limit) const {
+    uint32_t node;
+    size_t depth;
+    std::vector<Match> matches;
+    if ((limit == 0) || !descend(prefix, node, depth)) {
+        return matches;
+    }
+
+    // Best first by the length of the names a node ends. A node's names are longer than its parent's and the entries
+    // of nodes are in name order, so popping by (length, first entry) gives names by length, then in name order.
+    using Item = std::tuple<size_t, uint32_t, uint32_t>; // length, first entry, node
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    queue.emplace(depth, nodes[node].entry_begin, node);
+    while (!queue.empty() && (matches.size() < limit)) {
+        auto [length, first, n] = queue.top();
+        queue.pop();
+
+        for (uint32_t e = first; (e < first + nodes[n].exact_count) && (matches.size() < limit); e++) {
+            matches.push_back(get_match(e));
+        }
+        for (uint32_t c = nodes[n].first_child; c < nodes[n].first_child + nodes[n].child_count; c++) {
+            queue.emplace(length + nodes[c].label_size, nodes[c].entry_begin, c);
+        }
+    }
+    return matches;
+}
+
+std::vector<HeadwordTrie::Match> HeadwordTrie::find_fuzzy(std::string_view name, size_t max_distance, size_t limit) const {
+    FuzzySearch search;
+    search.query = decode(name);
+    search.max_distance = max_distance;
+    for (uint32_t j = 0; j <= search.query.size(); j++) {
+        search.rows.push_back(j);
+    }
+    visit_fuzzy(0, 0, 0, 0, search);
+
+    std::vector<std::pair<uint32_t, uint32_t>>& found = search.found;
+    size_t count = ((limit == 0) || (limit > found.size())) ? found.size() : limit;
+    std::partial_sort(found.begin(), found.begin() + count, found.end());
+
+    std::vector<Match> matches;
+    matches.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        matches.push_back(get_match(found[i].second));
+        matches.back().distance = found[i].first;
+    }
+    return matches;
+}
+
+size_t HeadwordTrie::get_edit_distance(std::string_view a, std::string_view b) {
+    std::vector<uint32_t> name = decode(a);
+    std::vector<uint32_t> query = decode(b);
+    size_t width = query.size() + 1;
+    std::vector<uint32_t> rows((name.size() + 1) * width);
+    for (uint32_t j = 0; j < width; j++) {
+        rows[j] = j;
+    }
+    for (size_t i = 1; i <= name.size(); i++) {
+        const uint32_t* prev = rows.data() + (i - 1) * width;
+        fill_row(query, (i > 1) ? prev - width : nullptr, prev, rows.data() + i * width, name[i - 1], (i > 1) ? name[i - 2] : 0);
+    }
+    return rows.back();
+}
+
+size_t HeadwordTrie::size() const {
+    return entry_count;
+}
+
+// Helpers
+
+bool HeadwordTrie::descend(std::string_view prefix, uint32_t& node, size_t& depth) const {
+    node = 0;
+    depth = 0;
+    while (depth < prefix.size()) {
+        const Node& parent = nodes[node];
+        const Node* first = nodes + parent.first_child;
+        const Node* last = first + parent.child_count;
+        unsigned char b = prefix[depth];
+        const Node* child = std::lower_bound(first, last, b, [this](const Node& n, unsigned char value) {
+            return static_cast<unsigned char>(names[n.label_offset]) < value;
+        });
+        if ((child == last) || (static_cast<unsigned char>(names[child->label_offset]) != b)) {
+            return false;
+        }
+
+        // The prefix may end inside the label, the child's names all start with it then
+        size_t n = std::min<size_t>(child->label_size, prefix.size() - depth);
+        if (std::memcmp(names + child->label_offset, prefix.data() + depth, n) != 0) {
+            return false;
+        }
+        node = child - nodes;
+        depth += child->label_size;
+    }
+    return true;
+}
+
+// Walks the subtree of node depth first, adding a row to the table for each character of the labels. Labels may end
+// inside a character (the trie splits names by byte), partial holds its bits so far and remaining the bytes it still
+// needs. Subtrees whose newest row is over the distance are skipped.
+void HeadwordTrie::visit_fuzzy(uint32_t node, size_t depth, uint32_t partial, int remaining, FuzzySearch& search) const {
+    const Node& n = nodes[node];
+    size_t width = search.query.size() + 1;
+    for (uint32_t b_i = 0; b_i < n.label_size; b_i++) {
+        unsigned char b = names[n.label_offset + b_i];
+        if (remaining > 0) {
+            partial = (partial << 6) | (b & 0x3F);
+            remaining--;
+        } else if (b < 0x80) {
+            partial = b;
+        } else if ((b & 0xE0) == 0xC0) {
+            partial = b & 0x1F;
+            remaining = 1;
+        } else if ((b & 0xF0) == 0xE0) {
+            partial = b & 0x0F;
+            remaining = 2;
+        } else if ((b & 0xF8) == 0xF0) {
+            partial = b & 0x07;
+            remaining = 3;
+        } else {
+            partial = 0xFFFD;
+        }
+        if (remaining > 0) {
+            continue;
+        }
+
+        if (search.rows.size() < (depth + 2) * width) {
+            search.rows.resize((depth + 2) * width);
+            search.path.resize(depth + 1);
+        }
+        search.path[depth] = partial;
+        const uint32_t* prev = search.rows.data() + depth * width;
+        uint32_t smallest = fill_row(search.query, (depth > 0) ? prev - width : nullptr, prev, search.rows.data() + (depth + 1) * width,
+            partial, (depth > 0) ? search.path[depth - 1] : 0);
+        depth++;
+        if (smallest > search.max_distance) {
+            return;
+        }
+    }
+
+    uint32_t distance = search.rows[depth * width + width - 1];
+    if ((remaining == 0) && (distance <= search.max_distance)) {
+        for (uint32_t e = n.entry_begin; e < n.entry_begin + n.exact_count; e++) {
+            search.found.emplace_back(distance, e);
+        }
+    }
+    for (uint32_t c = n.first_child; c < n.first_child + n.child_count; c++) {
+        visit_fuzzy(c, depth, partial, remaining, search);
+    }
+}
+
+HeadwordTrie::Match HeadwordTrie::get_match(uint32_t entry) const {
+    const Entry& e = entries[entry];
+    std::string_view category(names + category_offsets[e.category], category_offsets[e.category + 1] - category_offsets[e.category]);
+    return Match{std::string_view(names + e.name_offset, e.name_size), category, e.word};
+}
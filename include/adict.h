@@ -13,32 +13,92 @@ You should have received a copy of the GNU General Public License along with Adi
 #ifndef ADICT_H
 #define ADICT_H
 
-#include "word.h"
+#include "word_table.h"
+#include "word_renderer.h"
+#include "paragraph_cache.h"
 #include "../../docx/docx.hpp"
 
 #include <string>
+#include <iostream>
 #include <vector>
 #include <set>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
 
 class Adict {
 public:
     // Object functions
-    void print();
-    DOCX compile();
+    void print(std::ostream& out = std::cout) const; // only reads the dictionary, so it can run alongside compile
+    DOCX compile(size_t thread_count = 1, ParagraphCache* cache = nullptr); // thread_count 0 picks the thread count automatically
+
+    // Reads fpath into this (empty) Adict and compiles it in one pass. Paragraphs are built on thread_count threads
+    // while the file is still being parsed, see adict_pipeline.cpp. The result is the same as read then compile.
+    DOCX read_and_compile(std::string fpath, size_t thread_count = 0);
+
+    // Compiles straight into a .docx file through DocxStream, without holding the document in memory.
+    // Only the paragraphs of the words being built at the moment exist at any time. Throws std::runtime_error on write errors.
+    void write_docx(std::string fpath, size_t thread_count = 1) const;
 
     // Static functions
     static Adict read(std::string fpath);
+    static Adict load(std::string fpath); // read through the binary cache next to the JSON
+    static std::string get_cache_path(std::string fpath);
+    static void configure_script_analyzer();
+
+    // Makes read and load copy the JSON and its cache into memory rather than map them (see MappedFile), for
+    // processes that stay running while the file is edited. Off by default.
+    static void set_copy_sources(bool copy);
 
 private:
+    friend class AdictReader;
+    friend class TextIndex;
+    friend class HeadwordTrie;
+    friend class DictionarySnapshot;
+
     // Data variables
     std::map<std::string, std::string> meta;
     std::map<std::string, std::string> style;
     std::vector<std::string> subtitles;
-    std::map<std::string, std::vector<Word>> words_by_category;
+    WordTable words;
+    std::map<std::string, std::vector<uint32_t>> words_by_category; // ids in words, in input order
     std::vector<std::string> category_order;
+    std::string collation; // config.collation, see Collation::get_mode
+    std::vector<FieldFormat> field_formats; // config.fields, see WordRenderer
+    std::map<std::string, std::vector<size_t>> sorted_index; // positions in words_by_category of each category in alphabetical order, built once after loading
+
+    static std::atomic<bool> copy_sources; // see set_copy_sources
+
+    // Binary cache
+    struct CacheKey {
+        uint64_t size = 0;
+        int64_t mtime = 0; // nanoseconds, 0 if the file had just been modified when it was keyed
+        uint64_t hash = 0;
+    };
+    static bool get_cache_key(std::string fpath, CacheKey& key);
+    // The content is only hashed if the mtime differs or is 0. When it matches, the mtime is stored in the header of
+    // keyed_path (the cache, index or trie holding key) for the next check.
+    static bool is_source_unchanged(std::string fpath, const CacheKey& key, const std::string& keyed_path);
+    static bool read_cache(std::string fpath, Adict& adict);
+    void write_cache(std::string fpath, const CacheKey& key);
+
+    // Files kept next to the JSON (cache, index, trie)
+    static std::string get_derived_path(const std::string& fpath, const std::string& extension); // .json replaced by extension
+    // Writes parts to path + ".tmp" and renames it to path, so readers never see a half written file. Failures are
+    // reported on stderr as failures to write a kind file and leave path as it was.
+    static void write_derived_file(const std::string& path, std::initializer_list<std::string_view> parts, const char* kind);
 
     // Program functions
-    static std::vector<DOCX::Paragraph> get_vector_of_paragraphs_from_word(Word w, DOCX& docx);
+    void finish_reading(); // called once every word is in words_by_category
+    void build_sorted_index();
+    std::vector<uint32_t> get_sorted_words(const std::string& category) const; // ids
+    // Paragraph builders, Document is DOCX or DocxStream. Words are built by WordRenderer.
+    template<class Document>
+    void add_header(Document& docx) const; // title and subtitles
+    size_t get_category_title_size() const;
+    template<class Document>
+    static void add_category_heading(Document& docx, const std::string& category, size_t category_title_size);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ADICT_READER_H
+#define ADICT_READER_H
+
+#include "adict.h"
+#include "word.h"
+#include "json.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// SAX handler for nlohmann::json::sax_parse that fills an Adict while the tokens arrive,
+// so the whole document never has to exist as a json tree. Only one Word is held at a time, finished words are
+// copied into the Adict's WordTable.
+class AdictReader {
+public:
+    using number_integer_t = nlohmann::json::number_integer_t;
+    using number_unsigned_t = nlohmann::json::number_unsigned_t;
+    using number_float_t = nlohmann::json::number_float_t;
+    using string_t = nlohmann::json::string_t;
+    using binary_t = nlohmann::json::binary_t;
+
+    AdictReader(Adict& adict);
+
+    // Finished words go to handler instead of into the Adict, category is "*" for words without one.
+    // The word is reused for the next one once the handler returns.
+    using WordHandler = std::function<void(const std::string& category, const Word& word)>;
+    void set_word_handler(WordHandler handler);
+
+    // Parses a whole file into the Adict
+    void parse_file(const std::string& fpath);
+
+    // SAX interface
+    bool null();
+    bool boolean(bool val);
+    bool number_integer(number_integer_t val);
+    bool number_unsigned(number_unsigned_t val);
+    bool number_float(number_float_t val, const string_t& s);
+    bool string(string_t& val);
+    bool binary(binary_t& val);
+    bool start_object(std::size_t elements);
+    bool key(string_t& val);
+    bool end_object();
+    bool start_array(std::size_t elements);
+    bool end_array();
+
+    template<class Exception>
+    bool parse_error(std::size_t position, const std::string& last_token, const Exception& ex) {
+        throw ex;
+    }
+
+private:
+    enum State {
+        TOP,
+        ROOT,
+        META,
+        META_SUBTITLES,
+        STYLE,
+        CONFIG,
+        CONFIG_FIELDS,
+        CONFIG_FIELD,
+        CATEGORY_ORDER,
+        WORDS,
+        WORD,
+        WORD_FIELD_ARRAY
+    };
+
+    // Keys of a word object, resolved once per member in key() so values are dispatched with a switch
+    enum WordKey {
+        KEY_NAME,
+        KEY_DEFINITION,
+        KEY_CATEGORY,
+        KEY_ETYMOLOGY,
+        KEY_EXAMPLES,
+        KEY_EXAMPLE_SENTENCES,
+        KEY_INSPIRATIONS,
+        KEY_NOTES,
+        KEY_EXTRA // any other key, see Word::extra_fields
+    };
+
+    Adict& adict;
+    State state = TOP;
+    size_t skip_depth = 0; // nesting depth inside a container we don't care about
+    std::string cur_key;
+    FieldFormat field_format; // current entry of config.fields
+
+    // Current word
+    Word word;
+    std::string word_category;
+    bool word_has_category = false;
+    bool word_dropped = false;
+    WordKey word_key = KEY_EXTRA; // key of the current member of the word
+    std::vector<std::string>* word_field = nullptr;
+    WordHandler word_handler;
+
+    bool value(string_t& val);
+    static WordKey find_word_key(const std::string& key);
+    std::vector<std::string>* get_word_list_field(); // of word_key, extra keys go to Word::extra_fields
+    void commit_word();
+};
+
+#endif
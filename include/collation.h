@@ -0,0 +1,41 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef COLLATION_H
+#define COLLATION_H
+
+#include <string>
+#include <string_view>
+
+// Builds binary sort keys for headwords. Comparing two keys bytewise (memcmp order) gives the collation order
+// of the strings they were built from, so a key is computed once per word instead of collating in the comparator.
+//
+// ROOT follows the multi level scheme of the Unicode Collation Algorithm: base letters first (scripts in the order
+// Latin, Greek, Cyrillic, Arabic, Devanagari, Kana, then everything else), then diacritics, then case and kana type,
+// then the code points themselves to break any remaining ties. It is a small built in approximation of the root
+// collation, covering the scripts ScriptAnalyzer knows about, not a full DUCET implementation.
+// CODEPOINT keeps the plain bytewise order Adict used before.
+class Collation {
+public:
+    enum Mode {
+        ROOT,
+        CODEPOINT
+    };
+
+    static std::string get_sort_key(std::string_view s, Mode mode = ROOT);
+
+    // Maps the config.collation value of an Adict JSON to a mode ("root" or "codepoint", empty means root).
+    // Returns false for unknown names.
+    static bool get_mode(const std::string& name, Mode& mode);
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DOCX_STREAM_H
+#define DOCX_STREAM_H
+
+#include "zip_writer.h"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Writes a .docx file paragraph by paragraph. Each paragraph is turned into document.xml and deflated into the
+// zip as soon as it is added, so memory use doesn't grow with the document. Text and Paragraph mirror the parts of
+// DOCX::Text and DOCX::Paragraph that Adict uses, so the same code can build paragraphs for either.
+// Runs are split by script and get the ScriptAnalyzer typefaces, like DOCX does with its script analyzer enabled.
+//
+// Text and Paragraph take their memory from the arena in use on the calling thread (see Arena::Use), or from the
+// heap if there is none. Copies go to the arena of the thread making them.
+class DocxStream {
+public:
+    // Bump allocator for the paragraphs of a batch of words. Everything built in it is freed at once by release,
+    // which keeps the first block for the next batch, so a reused arena stops allocating once it is large enough.
+    // Nothing built in an arena may be used after it is released.
+    class Arena {
+    public:
+        Arena(size_t initial_size);
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void release();
+
+        // Makes the arena the one used on this thread for its lifetime
+        class Use {
+        public:
+            Use(Arena& arena);
+            ~Use();
+
+            Use(const Use&) = delete;
+            Use& operator=(const Use&) = delete;
+
+        private:
+            std::pmr::memory_resource* previous;
+        };
+
+    private:
+        std::unique_ptr<std::byte[]> initial_block;
+        std::pmr::monotonic_buffer_resource resource;
+    };
+
+    class Text {
+    public:
+        Text(std::string_view content = "");
+        Text(const Text& other);
+        Text(Text&& other) = default;
+        Text& operator=(const Text& other) = default;
+        Text& operator=(Text&& other) = default;
+
+        std::pmr::string content;
+        std::pmr::string typeface; // empty picks the typeface of the script
+        size_t size = 0; // in points, 0 is the global font size
+        bool bold = false;
+        bool italic = false;
+    };
+
+    class Paragraph {
+    public:
+        enum Align {
+            LEFT,
+            CENTER
+        };
+
+        Paragraph();
+        Paragraph(const Paragraph& other);
+        Paragraph(Paragraph&& other) = default;
+        Paragraph& operator=(const Paragraph& other) = default;
+        Paragraph& operator=(Paragraph&& other) = default;
+
+        void add_text(Text t);
+        void add_bold_text(std::string_view s);
+        void add_plain_text(std::string_view s);
+        void add_space(size_t count = 1, size_t size = 0);
+
+        Align align = LEFT;
+        std::pmr::vector<Text> texts;
+    };
+
+    // Throws std::runtime_error if fpath can't be written
+    DocxStream(const std::string& fpath, size_t global_font_size);
+
+    size_t get_global_font_size() const;
+
+    void add_paragraph(const Paragraph& p);
+    void add_empty_line(size_t count = 1);
+
+    // Finishes document.xml and the archive, nothing can be added afterwards
+    void close();
+
+private:
+    ZipWriter zip;
+    size_t global_font_size;
+    std::string buf; // document.xml waiting to be deflated
+
+    void add_run(const Text& t, std::string_view content, std::string_view typeface, bool rtl);
+    void flush_if_full();
+};
+
+#endif
@@ -0,0 +1,48 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+
+// Waits for changes to a single file with inotify. The parent directory is watched rather than the file
+// itself because many editors save by writing a new file and renaming it over the old one.
+class FileWatcher {
+public:
+    FileWatcher(const std::string& fpath);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool is_open() const;
+
+    // Blocks until the file changes, then keeps waiting until no further change has arrived for debounce_ms,
+    // so a burst of saves results in one return. Returns false if watching failed.
+    bool wait_for_change(int debounce_ms);
+
+    // Makes wait_for_change return false, now if another thread is waiting or else the next time it is called.
+    // Can be called once.
+    void stop();
+
+private:
+    int fd = -1;
+    int wd = -1;
+    std::string name;
+
+    // Reads the pending events, sets changed if one of them concerns the watched file. Returns false once the watch
+    // has been removed.
+    bool read_events(bool& changed);
+};
+
+#endif
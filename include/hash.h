@@ -0,0 +1,53 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring> // for memcpy
+
+// 64 bit FNV-1a, pass the previous result as seed to hash several pieces in a row
+const uint64_t FNV1A_SEED = 0xcbf29ce484222325ULL;
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = FNV1A_SEED) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Hash of a whole file's content, for telling whether it changed. FNV-1a over 8 byte words in four interleaved lanes,
+// several times faster than fnv1a on inputs of megabytes. Gives other values than fnv1a.
+inline uint64_t hash_content(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = {FNV1A_SEED, FNV1A_SEED + 1, FNV1A_SEED + 2, FNV1A_SEED + 3};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            std::memcpy(&w, bytes + i + l * 8, sizeof(w));
+            lanes[l] = (lanes[l] ^ w) * 0x100000001b3ULL;
+        }
+    }
+
+    uint64_t h = fnv1a(bytes + i, size - i);
+    h = fnv1a(lanes, sizeof(lanes), h);
+    uint64_t len = size;
+    return fnv1a(&len, sizeof(len), h);
+}
+
+#endif
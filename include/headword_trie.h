@@ -0,0 +1,112 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADWORD_TRIE_H
+#define HEADWORD_TRIE_H
+
+#include "adict.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable radix trie over the names of all words of an Adict, for exact, prefix and autocomplete lookups.
+// Names are compared bytewise. Each word is an entry holding its name, its category and its position in that
+// category (words_by_category order). Entries are kept in name order, so the entries under a node are one range
+// and a prefix lookup costs one descent. Node labels point into the names rather than being stored apart.
+//
+// The trie is one flat block, the same in memory and in the .adicttrie file next to the JSON, which is mapped
+// rather than read, so lookups don't need the JSON parsed.
+class HeadwordTrie {
+public:
+    struct Match {
+        std::string_view name;
+        std::string_view category; // "*" for words without one
+        uint32_t word; // position in the category, in input order
+        uint32_t distance = 0; // edits from the name looked up, set by find_fuzzy
+    };
+
+    static HeadwordTrie build(const Adict& adict);
+
+    // Opens the trie next to the JSON, building and saving it (through Adict::load) when it's missing or stale.
+    // Throws like Adict::load if the JSON has to be read and can't be.
+    static HeadwordTrie load(std::string fpath);
+    static std::string get_trie_path(std::string fpath);
+
+    // Words named exactly name, in category order
+    std::vector<Match> find(std::string_view name) const;
+
+    // Words whose name starts with prefix, in name order. limit 0 returns all of them.
+    std::vector<Match> find_prefix(std::string_view prefix, size_t limit = 0) const;
+    size_t count_prefix(std::string_view prefix) const; // without building the matches
+
+    // The limit shortest names starting with prefix, names of the same length in name order
+    std::vector<Match> complete(std::string_view prefix, size_t limit) const;
+
+    // Words whose name is at most max_distance edits from name, closest first, then in name order. An edit inserts,
+    // deletes or replaces a character (code point) or swaps two neighbouring ones. At most limit of them, 0 for all.
+    std::vector<Match> find_fuzzy(std::string_view name, size_t max_distance, size_t limit = 0) const;
+
+    // Edit distance counted the same way, for checking find_fuzzy against a plain scan
+    static size_t get_edit_distance(std::string_view a, std::string_view b);
+
+    size_t size() const; // number of words
+
+private:
+    struct Node {
+        uint32_t label_offset; // the label is names[label_offset, label_offset + label_size)
+        uint32_t label_size;
+        uint32_t first_child; // children are nodes[first_child, first_child + child_count), by first label byte
+        uint32_t child_count;
+        uint32_t entry_begin; // entries under the node are entries[entry_begin, entry_end),
+        uint32_t exact_count; // the first exact_count of them end at the node
+        uint32_t entry_end;
+    };
+
+    struct Entry {
+        uint32_t name_offset;
+        uint32_t name_size;
+        uint32_t category;
+        uint32_t word;
+    };
+
+    std::vector<char> owned; // the block of a built trie
+    std::unique_ptr<MappedFile> mapped; // or of an opened one
+
+    // Views into the block, set by attach
+    const Node* nodes = nullptr;
+    const Entry* entries = nullptr;
+    const uint32_t* category_offsets = nullptr;
+    const char* names = nullptr;
+    size_t node_count = 0;
+    size_t entry_count = 0;
+    size_t category_count = 0;
+    size_t names_size = 0;
+
+    bool attach(const char* data, size_t size); // checks the block, false if it's malformed
+    static bool open(std::string fpath, HeadwordTrie& trie);
+    void save(std::string fpath, const Adict::CacheKey& key) const;
+
+    // Node under which every name starting with prefix is, and the length of the names the node ends.
+    // Returns false if no name starts with prefix.
+    bool descend(std::string_view prefix, uint32_t& node, size_t& depth) const;
+    Match get_match(uint32_t entry) const;
+
+    struct FuzzySearch;
+    void visit_fuzzy(uint32_t node, size_t depth, uint32_t partial, int remaining, FuzzySearch& search) const;
+};
+
+#endif
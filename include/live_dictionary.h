@@ -0,0 +1,81 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIVE_DICTIONARY_H
+#define LIVE_DICTIONARY_H
+
+#include "adict.h"
+#include "text_index.h"
+#include "headword_trie.h"
+#include "word_renderer.h"
+#include "docx_stream.h"
+#include "file_watcher.h"
+#include "snapshot_cell.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// One version of a dictionary with everything lookups need, built once and never changed afterwards, so that any
+// number of threads can use it at the same time
+class DictionarySnapshot {
+public:
+    // Reads fpath (through the binary cache) and builds its index and trie. Throws like Adict::load.
+    static std::unique_ptr<const DictionarySnapshot> load(const std::string& fpath);
+
+    TextIndex index;
+    HeadwordTrie trie;
+
+    // The word-th word of category, in words_by_category order as numbered by the index and the trie.
+    // Throws std::out_of_range if there's no such word.
+    WordTable::WordView get_word(std::string_view category, uint32_t word) const;
+
+    // Paragraphs of a word as compile builds them
+    std::vector<DocxStream::Paragraph> render(const WordTable::WordView& w) const;
+
+private:
+    Adict adict;
+    std::unique_ptr<WordRenderer<DocxStream>> renderer;
+};
+
+// The current snapshot of a dictionary JSON, which can be reloaded in the background whenever the file changes.
+// A Reader keeps the snapshot that was current when it was made until it is destroyed, without taking locks, and a
+// reload deletes the old snapshot once no reader is using it anymore (see SnapshotCell).
+class LiveDictionary {
+public:
+    using Reader = SnapshotCell<DictionarySnapshot>::Reader;
+
+    // Loads the first snapshot, throws like Adict::load
+    LiveDictionary(const std::string& fpath);
+    ~LiveDictionary(); // stops reloading
+
+    LiveDictionary(const LiveDictionary&) = delete;
+    LiveDictionary& operator=(const LiveDictionary&) = delete;
+
+    Reader read() const;
+
+    // Starts a thread that loads a new snapshot whenever the file is saved and swaps it in. A version that can't be
+    // loaded is reported and the current snapshot kept. Returns false if the file can't be watched.
+    bool start_reloading();
+
+private:
+    std::string fpath;
+    SnapshotCell<DictionarySnapshot> current;
+    std::unique_ptr<FileWatcher> watcher;
+    std::thread reloader;
+
+    void reload_on_changes();
+};
+
+#endif
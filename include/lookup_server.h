@@ -0,0 +1,66 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOOKUP_SERVER_H
+#define LOOKUP_SERVER_H
+
+#include "live_dictionary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Keeps a dictionary, its full-text index and its headword trie in memory and answers lookups on them over a Unix
+// domain socket, so tools don't have to start adict and load the dictionary for every lookup. The dictionary is
+// reloaded when the JSON changes (see LiveDictionary), each request is answered from one snapshot.
+//
+// Requests and responses are frames: a 4 byte big endian length, then that many bytes. A request is a command and
+// its arguments separated by tabs, a response an "ok N" line (N matches in all) or an "error message" line followed
+// by the results, see README. The thread calling serve reads and writes every connection without blocking and hands
+// each complete request to a pool of threads, so any number of clients can stay connected and a slow one never holds
+// a worker.
+class LookupServer {
+public:
+    // Loads fpath (through the binary cache) and builds its index and trie. Throws like Adict::load.
+    // With reload set, the dictionary is reloaded in the background whenever the file changes, if it can be watched.
+    LookupServer(const std::string& fpath, bool reload = true);
+
+    ~LookupServer();
+
+    LookupServer(const LookupServer&) = delete;
+    LookupServer& operator=(const LookupServer&) = delete;
+
+    // Listens on socket_path, replacing a socket file no server answers on. Throws std::runtime_error if the socket
+    // can't be set up.
+    void listen(const std::string& socket_path);
+
+    // Serves clients on thread_count threads (0 picks automatically) for as long as the process runs. Running out of
+    // file descriptors pauses accepting for a moment, other failures throw std::runtime_error.
+    void serve(size_t thread_count);
+
+    // Response to a single request, without the framing
+    std::string answer(std::string_view request) const;
+
+private:
+    LiveDictionary dictionary;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1; // eventfd the workers signal when a response is ready
+    std::string socket_path;
+
+    // Appends the paragraphs of the word-th word of category in d as lines of text, or as HTML paragraphs with the bold
+    // and italic runs marked
+    static void render_word(const DictionarySnapshot& d, std::string_view category, uint32_t word, bool html, std::string& out);
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <vector>
+
+// Read-only memory mapping of a whole file. is_open() is false if the file
+// can't be opened or mapped (empty files can't be mapped either).
+//
+// With copy set the file is read into memory instead. Use it for files another process may truncate while they
+// are in use: touching the lost pages of a mapping raises SIGBUS, a copy just ends early.
+class MappedFile {
+public:
+    MappedFile(const std::string& fpath, bool copy = false);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+    std::vector<char> buffer; // the copy, if there is one
+};
+
+#endif
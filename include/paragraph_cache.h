@@ -0,0 +1,57 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARAGRAPH_CACHE_H
+#define PARAGRAPH_CACHE_H
+
+#include "word_table.h"
+#include "../../docx/docx.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Keeps the paragraphs built for each word between compiles, keyed by a hash of the word's contents,
+// so recompiling an edited dictionary only builds paragraphs for new and changed words.
+// Entries that a compile didn't use are dropped at the end of it.
+class ParagraphCache {
+public:
+    // format_hash is WordRenderer::get_format_hash
+    static uint64_t get_word_hash(const WordTable::WordView& w, uint64_t format_hash);
+
+    // Returns nullptr if there's no entry for the hash. Safe to call from several threads as long as nothing is inserted meanwhile.
+    const std::vector<DOCX::Paragraph>* find(uint64_t hash) const;
+
+    // Stores (or replaces) an entry and marks it as used, returns the stored paragraphs
+    const std::vector<DOCX::Paragraph>* insert(uint64_t hash, std::vector<DOCX::Paragraph> paragraphs);
+
+    void mark_used(uint64_t hash);
+
+    // Drops the entries that weren't used since the previous prune
+    void prune();
+
+    size_t size() const;
+
+    // Counters of the last compile
+    size_t hits = 0;
+    size_t misses = 0;
+
+private:
+    struct Entry {
+        std::vector<DOCX::Paragraph> paragraphs;
+        bool used = false;
+    };
+
+    std::unordered_map<uint64_t, Entry> entries;
+};
+
+#endif
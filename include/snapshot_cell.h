@@ -0,0 +1,82 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNAPSHOT_CELL_H
+#define SNAPSHOT_CELL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+// Holds the current version of an immutable T, read on any number of threads while one writer at a time replaces it.
+// Readers take no locks and never wait: a Reader counts itself in one of two counters, then loads the pointer, and
+// keeps that version until it is destroyed. Replacing publishes the new version at once but deletes the old one only
+// when no reader can still be using it, in the manner of RCU: the writer points new readers at the other counter and
+// waits for this one to drain, then does the same the other way round, so readers that picked their counter before
+// an earlier switch are waited for too.
+template<class T>
+class SnapshotCell {
+public:
+    SnapshotCell(std::unique_ptr<const T> initial) : current(initial.release()) {}
+    ~SnapshotCell() { delete current.load(); } // no Reader may be left
+
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    class Reader {
+    public:
+        Reader(const SnapshotCell& cell) : cell(cell) {
+            side = cell.side.load();
+            cell.readers[side].count.fetch_add(1);
+            value = cell.current.load();
+        }
+        ~Reader() { cell.readers[side].count.fetch_sub(1); }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const T& operator*() const { return *value; }
+        const T* operator->() const { return value; }
+
+    private:
+        const SnapshotCell& cell;
+        unsigned side;
+        const T* value;
+    };
+
+    // Publishes next, then waits for the readers of the old version and deletes it
+    void replace(std::unique_ptr<const T> next) {
+        const T* old = current.exchange(next.release());
+        for (int pass = 0; pass < 2; pass++) {
+            unsigned s = side.load();
+            side.store(s ^ 1);
+            while (readers[s].count.load() != 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        delete old;
+    }
+
+private:
+    // Apart, so that readers counting on one side don't slow down those on the other
+    struct alignas(64) Counter {
+        std::atomic<size_t> count{0};
+    };
+
+    std::atomic<const T*> current;
+    std::atomic<unsigned> side{0}; // counter new readers use
+    mutable Counter readers[2];
+};
+
+#endif
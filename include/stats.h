@@ -0,0 +1,71 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Opt-in timers and allocation counters for the stages of a build, reported as JSON by adict --stats.
+// Stages are recorded with STATS_SCOPE, which times the rest of the enclosing block and counts the allocations
+// the calling thread made in it. Scopes of the same name add up, so a stage run in chunks on several threads
+// reports the sum of the threads' times.
+//
+// While stats aren't enabled a scope costs one branch. Building with -DADICT_NO_STATS removes the scopes and
+// the allocation counting altogether.
+class Stats {
+public:
+    // Returns false if the program was built without stats
+    static bool enable();
+    static bool is_enabled();
+
+    // Forgets everything recorded so far
+    static void reset();
+
+    // Allocations made by the whole process so far
+    static uint64_t get_allocation_count();
+
+    // {"stages": {name: {"calls", "ms", "items", "allocations", "allocated_bytes"}}, "allocations": total}
+    static std::string get_json();
+
+#ifndef ADICT_NO_STATS
+    class Scope {
+    public:
+        // items is what the stage processed (words, paragraphs...), reported as is
+        Scope(const char* name, size_t items = 0);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        size_t items;
+        bool active;
+        int64_t start_ns = 0;
+        uint64_t start_allocations = 0;
+        uint64_t start_bytes = 0;
+    };
+#endif
+};
+
+#ifndef ADICT_NO_STATS
+#define STATS_CONCAT_INNER(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_INNER(a, b)
+#define STATS_SCOPE(...) Stats::Scope STATS_CONCAT(stats_scope_, __LINE__)(__VA_ARGS__)
+#else
+#define STATS_SCOPE(...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include "adict.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Inverted index of the words of an Adict by the terms in their definition, examples, example sentences and notes.
+// Words are numbered in words_by_category order (categories by name, then input order) and each term has a list of
+// the numbers of the words it appears in, delta and varint encoded. The category, name and definition of every word
+// are kept too, so a query needs nothing but the index.
+//
+// The index is one flat block, the same in memory and in the .adictidx file next to the JSON, which is mapped
+// rather than read.
+class TextIndex {
+public:
+    static TextIndex build(const Adict& adict);
+
+    // Opens the index next to the JSON, building and saving it (through Adict::load) when it's missing or stale.
+    // Throws like Adict::load if the JSON has to be read and can't be.
+    static TextIndex load(std::string fpath);
+    static std::string get_index_path(std::string fpath);
+
+    // Numbers of the words that contain every term of the query, ascending
+    std::vector<uint32_t> search(std::string_view query) const;
+
+    size_t size() const; // number of words
+    std::string_view get_category(uint32_t word) const;
+    std::string_view get_name(uint32_t word) const;
+    std::string_view get_definition(uint32_t word) const;
+
+    // Splits text into lower cased terms at anything that isn't a letter, digit or combining mark
+    static void tokenize(std::string_view text, std::vector<std::string>& terms);
+
+private:
+    std::vector<char> owned; // the block of a built index
+    std::unique_ptr<MappedFile> mapped; // or of an opened one
+
+    // Views into the block, set by attach
+    const uint32_t* docs = nullptr; // category, name and definition string ids of each word
+    const uint32_t* terms = nullptr; // string id, posting offset and word count of each term, sorted by term
+    const uint32_t* string_offsets = nullptr;
+    const char* blob = nullptr;
+    const unsigned char* postings = nullptr;
+    size_t doc_count = 0;
+    size_t term_count = 0;
+    size_t string_count = 0;
+    size_t blob_size = 0;
+    size_t postings_size = 0;
+
+    bool attach(const char* data, size_t size); // checks the block, false if it's malformed
+    static bool open(std::string fpath, TextIndex& index);
+    void save(std::string fpath, const Adict::CacheKey& key) const;
+
+    std::string_view get_string(uint32_t id) const;
+    bool find_term(std::string_view term, size_t& t) const;
+    void decode_postings(size_t t, std::vector<uint32_t>& out) const;
+};
+
+#endif
@@ -16,6 +16,7 @@ You should have received a copy of the GNU General Public License along with Adi
 #include <string>
 #include <vector>
 
+// A word while it is being read, complete words are stored in a WordTable
 class Word {
 public:
     std::string name;
@@ -25,6 +26,36 @@ public:
     std::vector<std::string> example_sentences;
     std::vector<std::string> inspirations;
     std::vector<std::string> notes;
+
+    // Fields other than the ones above, in input order. They are only written if config.fields names them.
+    struct ExtraField {
+        std::string key;
+        std::vector<std::string> entries;
+    };
+    std::vector<ExtraField> extra_fields;
+
+    // Returns the entries of an extra field, adding the field if the word doesn't have it yet
+    std::vector<std::string>* get_extra_field(const std::string& key) {
+        for (ExtraField& f : extra_fields) {
+            if (f.key == key) {
+                return &f.entries;
+            }
+        }
+        extra_fields.push_back(ExtraField{key, {}});
+        return &extra_fields.back().entries;
+    }
+
+    // Empties every field, keeping the memory for the next word
+    void clear() {
+        name.clear();
+        definition.clear();
+        etymology.clear();
+        examples.clear();
+        example_sentences.clear();
+        inspirations.clear();
+        notes.clear();
+        extra_fields.clear();
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORD_RENDERER_H
+#define WORD_RENDERER_H
+
+#include "word_table.h"
+#include "docx_stream.h"
+#include "../../docx/docx.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How a list field of a word is written, on a line of its own under the name and definition:
+// the label in italics and a colon, then the entries, each between quote, with separator and a space between them
+struct FieldFormat {
+    std::string key; // JSON key of the field
+    std::string label;
+    std::string separator = ",";
+    std::string quote;
+
+    bool operator==(const FieldFormat& other) const;
+};
+
+// Builds the paragraphs of words. The built-in formats (etymology, examples, example sentences, inspirations and
+// notes, in that order) are replaced by the configured ones with the same key, configured formats for other keys
+// follow them. Texts that are the same for every word (labels, colons, separators, quotes) are made once here and
+// copied into the paragraphs. Document is DOCX or DocxStream.
+template<class Document>
+class WordRenderer {
+public:
+    using Paragraph = typename Document::Paragraph;
+    using Text = typename Document::Text;
+
+    WordRenderer(const std::vector<FieldFormat>& configured_fields, size_t global_font_size);
+
+    std::vector<Paragraph> render(const WordTable::WordView& w) const;
+
+    // Changes whenever the paragraphs of some word would, for keying cached paragraphs
+    uint64_t get_format_hash() const;
+
+private:
+    struct Field {
+        std::string key;
+        int list; // WordTable::ListField, -1 for an extra field
+        Text label;
+        Text colon;
+        Text separator;
+        Text quote;
+        bool has_separator;
+        bool has_quote;
+    };
+
+    std::vector<Field> fields;
+    size_t subsize;
+    uint64_t format_hash;
+};
+
+#endif
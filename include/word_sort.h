@@ -0,0 +1,44 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORD_SORT_H
+#define WORD_SORT_H
+
+#include "word_table.h"
+#include "collation.h"
+
+#include <string_view>
+#include <vector>
+
+// Categories with at least this many words are sorted on several threads
+const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+// Ranges with at least this many words are radix sorted, smaller ones use std::sort
+const size_t RADIX_SORT_THRESHOLD = 1 << 12;
+
+// Radix sort buckets smaller than this are finished with std::sort
+const size_t RADIX_SORT_CUTOFF = 32;
+
+// Sets the sort keys of every word in the table.
+// thread_count 0 picks the thread count automatically, smaller tables are always done on the calling thread.
+void build_sort_keys(WordTable& words, Collation::Mode mode, size_t thread_count = 0);
+
+// Returns the indices of keys in sorted order. Equal keys keep their original order.
+// thread_count works the same way as above.
+std::vector<size_t> sort_word_indices(const std::vector<std::string_view>& keys, size_t thread_count = 0);
+
+// Single threaded backends of sort_word_indices, both sort order[begin, end) by key and give the same result.
+// Exposed so they can be benchmarked against each other.
+void comparison_sort_indices(const std::vector<std::string_view>& keys, std::vector<size_t>& order, size_t begin, size_t end);
+void radix_sort_indices(const std::vector<std::string_view>& keys, std::vector<size_t>& order, size_t begin, size_t end);
+
+#endif
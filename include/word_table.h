@@ -0,0 +1,163 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORD_TABLE_H
+#define WORD_TABLE_H
+
+#include "word.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Column store of words. The text of every word lives in one UTF-8 pool and the columns hold (offset, size)
+// references into it. The entries of the five list fields of all words share one array, with a CSR style index
+// giving the range of each word's field, so empty lists cost 4 bytes. Extra fields (Word::extra_fields) keep their
+// entries in the same array and cost 8 bytes per word without any. Short strings are interned, repeated ones
+// (common etymology roots, example words...) are stored once.
+//
+// Words are addressed by id, their position in the table. Views stay valid until the next add.
+class WordTable {
+public:
+    enum ListField {
+        ETYMOLOGY,
+        EXAMPLES,
+        EXAMPLE_SENTENCES,
+        INSPIRATIONS,
+        NOTES,
+        LIST_FIELD_COUNT
+    };
+
+    struct StringRef {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // The entries of one list field of a word
+    class List {
+    public:
+        List(const char* pool, const StringRef* refs, size_t count);
+
+        size_t size() const;
+        bool empty() const;
+        std::string_view operator[](size_t i) const;
+        std::string_view at(size_t i) const; // throws std::out_of_range
+
+    private:
+        const char* pool;
+        const StringRef* refs;
+        size_t count;
+    };
+
+    struct ExtraRange {
+        StringRef key;
+        uint32_t begin = 0; // entries are list_entries[begin, end)
+        uint32_t end = 0;
+    };
+
+    // The extra fields of a word
+    class ExtraFields {
+    public:
+        ExtraFields(const char* pool, const StringRef* entries, const ExtraRange* ranges, size_t count);
+
+        size_t size() const;
+        std::string_view get_key(size_t i) const;
+        List get(size_t i) const;
+        List find(std::string_view key) const; // empty if the word doesn't have the field
+
+    private:
+        const char* pool;
+        const StringRef* entries;
+        const ExtraRange* ranges;
+        size_t count;
+    };
+
+    // Read only view of a word with the same members as Word
+    class WordView {
+    public:
+        std::string_view name;
+        std::string_view definition;
+        List etymology;
+        List examples;
+        List example_sentences;
+        List inspirations;
+        List notes;
+        ExtraFields extra_fields;
+
+        const List& get_list(ListField f) const;
+    };
+
+    // A word whose strings are already in the pool, see use_pool
+    struct WordRefs {
+        StringRef name;
+        StringRef definition;
+        std::vector<StringRef> entries; // of the five list fields, then of the extra fields
+        uint32_t list_ends[LIST_FIELD_COUNT] = {}; // the entries of list field f end at list_ends[f]
+        std::vector<ExtraRange> extra_fields; // begin and end index entries
+    };
+
+    // Copies a word into the table and returns its id, a WordView must be of another table.
+    // Throws std::length_error if the pool would outgrow 4 GiB.
+    uint32_t add(const Word& w);
+    uint32_t add(const WordView& w);
+    uint32_t add(const WordRefs& w);
+
+    void reserve_pool(size_t size); // bytes of text expected
+
+    // Makes text, kept alive by owner, the pool of an empty table so that words can be added as WordRefs without
+    // copying their strings. Adding a Word or WordView copies the text into the table first.
+    void use_pool(std::shared_ptr<const void> owner, std::string_view text);
+
+    size_t size() const;
+    WordView get(uint32_t id) const;
+    std::string_view get_name(uint32_t id) const;
+
+    // Binary collation key of each word's name, see build_sort_keys in word_sort.h.
+    // Kept apart from the text pool so that a sort only walks keys.
+    // Adding a word drops the keys.
+    void set_sort_keys(std::string chars, std::vector<uint32_t> offsets); // offsets has size()+1 entries
+    std::string_view get_sort_key(uint32_t id) const;
+
+private:
+    std::string pool;
+    std::string_view outside_pool; // used instead of pool while set, see use_pool
+    std::shared_ptr<const void> outside_pool_owner;
+    std::vector<StringRef> names;
+    std::vector<StringRef> definitions;
+    std::vector<StringRef> list_entries;
+    // Entries of field f of word w are list_entries[list_begins[w*6+f], list_begins[w*6+f+1]), the sixth range holds the extra fields
+    std::vector<uint32_t> list_begins{0};
+    std::vector<ExtraRange> extra_ranges;
+    std::vector<uint32_t> extra_begins{0}; // extra fields of word w are extra_ranges[extra_begins[w], extra_begins[w+1])
+
+    std::string sort_key_chars;
+    std::vector<uint32_t> sort_key_offsets;
+
+    // Open addressing set of interned strings, an empty slot has size 0
+    std::vector<StringRef> intern_slots;
+    size_t interned_count = 0;
+
+    StringRef add_string(std::string_view s);
+    void push_list_entry(std::string_view s);
+    void push_extra_range(std::string_view key, uint32_t begin);
+    uint32_t finish_word();
+    void own_pool();
+    const char* pool_data() const;
+    void grow_intern_slots();
+    std::string_view get_string(StringRef r) const;
+    List get_list(uint32_t id, ListField f) const;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ZIP_WRITER_H
+#define ZIP_WRITER_H
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes a zip archive entry by entry. Entries are deflated as their data arrives and their sizes and CRC go in a
+// data descriptor after the data, so an entry never has to be held in memory whole. No zip64, so every entry and
+// the archive itself must stay under 4 GiB. Write errors throw std::runtime_error.
+//
+// The archive is written to fpath + ".tmp" and renamed to fpath by close, so fpath is never left half written. An
+// archive that isn't closed is removed.
+class ZipWriter {
+public:
+    ZipWriter(const std::string& fpath);
+    ~ZipWriter();
+
+    ZipWriter(const ZipWriter&) = delete;
+    ZipWriter& operator=(const ZipWriter&) = delete;
+
+    bool is_open() const;
+
+    // Only one entry can be open at a time, begin_entry ends the previous one
+    void begin_entry(const std::string& name);
+    void write(const char* data, size_t size);
+    void write(const std::string& s);
+    void end_entry();
+
+    // Ends the open entry, writes the central directory and moves the archive to its path
+    void close();
+
+private:
+    struct Entry {
+        std::string name;
+        uint32_t crc = 0;
+        uint32_t compressed_size = 0;
+        uint32_t size = 0;
+        uint32_t offset = 0;
+    };
+
+    std::string path;
+    std::string tmp_path;
+    std::ofstream f;
+    std::vector<Entry> entries;
+    bool entry_open = false;
+    bool closed = false;
+    z_stream zs;
+    std::vector<unsigned char> out_buf;
+    uint64_t crc = 0;
+    uint64_t size = 0;
+    uint64_t compressed_size = 0;
+
+    void deflate_input(int flush);
+    uint32_t get_offset();
+    void put_u16(uint16_t v);
+    void put_u32(uint32_t v);
+    void put_bytes(const void* data, size_t size);
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/live_dictionary.h"
+
+// Standard includes
+#include <exception>
+#include <iostream>
+
+namespace {
+
+// Quiet time after the last change to the file before it is reloaded, as in watch mode
+const int RELOAD_DEBOUNCE_MS = 250;
+
+} // namespace
+
+std::unique_ptr<const DictionarySnapshot> DictionarySnapshot::load(const std::string& fpath) {
+    std::unique_ptr<DictionarySnapshot> snapshot = std::make_unique<DictionarySnapshot>();
+    snapshot->adict = Adict::load(fpath);
+    snapshot->index = TextIndex::build(snapshot->adict);
+    snapshot->trie = HeadwordTrie::build(snapshot->adict);
+    snapshot->renderer = std::make_unique<WordRenderer<DocxStream>>(snapshot->adict.field_formats, DOCX().get_global_font_size());
+    return snapshot;
+}
+
+WordTable::WordView DictionarySnapshot::get_word(std::string_view category, uint32_t word) const {
+    return adict.words.get(adict.words_by_category.at(std::string(category)).at(word));
+}
+
+std::vector<DocxStream::Paragraph> DictionarySnapshot::render(const WordTable::WordView& w) const {
+    return renderer->render(w);
+}
+
+LiveDictionary::LiveDictionary(const std::string& fpath) : fpath(fpath), current(DictionarySnapshot::load(fpath)) {}
+
+LiveDictionary::~LiveDictionary() {
+    if (reloader.joinable()) {
+        watcher->stop();
+        reloader.join();
+    }
+}
+
+LiveDictionary::Reader LiveDictionary::read() const {
+    return Reader(current);
+}
+
+bool LiveDictionary::start_reloading() {
+    if (reloader.joinable()) {
+        return true;
+    }
+    watcher = std::make_unique<FileWatcher>(fpath);
+    if (!watcher->is_open()) {
+        return false;
+    }
+    reloader = std::thread(&LiveDictionary::reload_on_changes, this);
+    return true;
+}
+
+void LiveDictionary::reload_on_changes() {
+    while (watcher->wait_for_change(RELOAD_DEBOUNCE_MS)) {
+        // Readers go on with the current snapshot while the new one is built
+        std::unique_ptr<const DictionarySnapshot> next;
+        try {
+            next = DictionarySnapshot::load(fpath);
+        } catch (const std::exception& e) {
+            std::cerr << "Could not reload " << fpath << ", keeping the previous version: " << e.what() << "\n";
+            continue;
+        }
+        current.replace(std::move(next));
+        std::cerr << "Reloaded " << fpath << "\n";
+    }
+}
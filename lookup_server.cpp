@@ -0,0 +1,544 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/lookup_server.h"
+#include "include/thread_pool.h"
+
+// System includes
+#include <fcntl.h> // for making the listening socket nonblocking
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Standard includes
+#include <cerrno>
+#include <chrono>
+#include <cstring> // for strerror
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility> // for move and pair
+#include <vector>
+
+namespace {
+
+// Matches sent for prefix, complete, fuzzy and query unless the request gives a limit, as on the command line
+const size_t DEFAULT_LIMIT = 20;
+
+// Edits allowed by fuzzy unless the request gives a distance, and the most a request may give. The trie walk grows
+// quickly with the distance, and at a few edits most short names match anyway.
+const size_t DEFAULT_DISTANCE = 2;
+const size_t MAX_DISTANCE = 4;
+
+// Longest request accepted, the connection is closed after a longer one
+const uint32_t MAX_REQUEST_SIZE = 1 << 20;
+
+// Bytes read from a connection at a time
+const size_t RECV_BUFFER_SIZE = 1 << 16;
+
+// How long accepting pauses when the process or the system is out of file descriptors
+const int ACCEPT_BACKOFF_MS = 100;
+
+// epoll data of the listening socket and the wake eventfd, connections are numbered after them
+const uint64_t LISTEN_ID = 0;
+const uint64_t WAKE_ID = 1;
+
+struct Connection {
+    int fd = -1;
+    std::string in; // received, not handed to a worker yet
+    std::string out; // framed responses not sent yet, from out_pos on
+    size_t out_pos = 0;
+    bool busy = false; // a worker is answering a request of this connection
+    bool eof = false; // the client won't send more
+    uint32_t events = 0; // polled for
+};
+
+// Size of the request at the front of in, false until its header has arrived
+bool get_request_size(const std::string& in, uint32_t& size) {
+    if (in.size() < 4) {
+        return false;
+    }
+    const unsigned char* h = reinterpret_cast<const unsigned char*>(in.data());
+    size = (uint32_t(h[0]) << 24) | (uint32_t(h[1]) << 16) | (uint32_t(h[2]) << 8) | h[3];
+    return true;
+}
+
+// True once in starts with a whole request, or with the header of one that is too long
+bool has_request(const std::string& in) {
+    uint32_t size;
+    return get_request_size(in, size) && ((size > MAX_REQUEST_SIZE) || (in.size() - 4 >= size));
+}
+
+void append_frame(std::string& out, const std::string& response) {
+    uint32_t n = response.size();
+    out += static_cast<char>(n >> 24);
+    out += static_cast<char>(n >> 16);
+    out += static_cast<char>(n >> 8);
+    out += static_cast<char>(n);
+    out += response;
+}
+
+// Reads what the client has sent, up to the end of the first request. False if the connection failed.
+bool receive(Connection& c) {
+    char buf[RECV_BUFFER_SIZE];
+    while (!has_request(c.in)) {
+        ssize_t r = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        if (r == 0) {
+            c.eof = true;
+            return true;
+        }
+        c.in.append(buf, r);
+    }
+    return true;
+}
+
+// Sends as much of the pending responses as the socket takes. False if the client has gone away; without
+// MSG_NOSIGNAL that would raise SIGPIPE.
+bool flush(Connection& c) {
+    while (c.out_pos < c.out.size()) {
+        ssize_t r = send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        c.out_pos += r;
+    }
+    c.out.clear();
+    c.out_pos = 0;
+    return true;
+}
+
+std::vector<std::string_view> split_fields(std::string_view s) {
+    std::vector<std::string_view> fields;
+    size_t begin = 0;
+    while (true) {
+        size_t end = s.find('\t', begin);
+        if (end == std::string_view::npos) {
+            fields.push_back(s.substr(begin));
+            return fields;
+        }
+        fields.push_back(s.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+// Parses field i as a count, fallback if there's no such field. Returns false if it isn't a number.
+bool get_count(const std::vector<std::string_view>& fields, size_t i, size_t fallback, size_t& out) {
+    out = fallback;
+    if (i >= fields.size()) {
+        return true;
+    }
+    if (fields[i].empty() || (fields[i].size() > 9) || (fields[i].find_first_not_of("0123456789") != std::string_view::npos)) {
+        return false;
+    }
+    out = 0;
+    for (char c : fields[i]) {
+        out = out * 10 + (c - '0');
+    }
+    return true;
+}
+
+// Appends s as one response field, with tabs, line breaks and backslashes written as \t, \n and \\ (see README)
+void append_field(std::string& out, std::string_view s) {
+    for (char c : s) {
+        switch (c) {
+            case '\t': out += "\\t"; break;
+            case '\n': out += "\\n"; break;
+            case '\\': out += "\\\\"; break;
+            default: out += c;
+        }
+    }
+}
+
+void append_escaped(std::string& out, std::string_view s) {
+    for (char c : s) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+}
+
+// "ok N" line and a line for each match: name, category and, for fuzzy lookups, distance, separated by tabs
+std::string get_match_lines(const std::vector<HeadwordTrie::Match>& matches, size_t total, bool with_distance) {
+    std::string out = "ok " + std::to_string(total) + "\n";
+    for (const HeadwordTrie::Match& m : matches) {
+        append_field(out, m.name);
+        out += '\t';
+        append_field(out, m.category);
+        if (with_distance) {
+            out += '\t';
+            out += std::to_string(m.distance);
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace
+
+LookupServer::LookupServer(const std::string& fpath, bool reload) : dictionary(fpath) {
+    if (reload && !dictionary.start_reloading()) {
+        std::cerr << "Could not watch " << fpath << ", it won't be reloaded" << "\n";
+    }
+}
+
+LookupServer::~LookupServer() {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+}
+
+void LookupServer::listen(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("socket path is too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    const sockaddr* a = reinterpret_cast<const sockaddr*>(&addr);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("can't create a socket: ") + std::strerror(errno));
+    }
+
+    // A socket file left behind by a server that is gone is replaced, one a server still answers on isn't
+    struct stat st;
+    if ((stat(path.c_str(), &st) == 0) && S_ISSOCK(st.st_mode)) {
+        if (connect(fd, a, sizeof(addr)) == 0) {
+            close(fd);
+            throw std::runtime_error("a server is already listening on " + path);
+        }
+        unlink(path.c_str());
+        close(fd);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("can't create a socket: ") + std::strerror(errno));
+        }
+    }
+
+    // Nonblocking so that serve can accept until there's nobody left waiting
+    if ((bind(fd, a, sizeof(addr)) < 0) || (chmod(path.c_str(), 0600) < 0) || (::listen(fd, SOMAXCONN) < 0) ||
+        (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)) {
+        std::string reason = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("can't listen on " + path + ": " + reason);
+    }
+    listen_fd = fd;
+    socket_path = path;
+}
+
+void LookupServer::serve(size_t thread_count) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN;
+    listen_event.data.u64 = LISTEN_ID;
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.u64 = WAKE_ID;
+    if ((epoll_fd < 0) || (wake_fd < 0) || (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) < 0) ||
+        (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) < 0)) {
+        throw std::runtime_error(std::string("can't poll connections: ") + std::strerror(errno));
+    }
+
+    // Connections are only touched on this thread. Ids rather than fds name them, since a closed connection's fd can
+    // be reused while a worker is still answering it.
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t next_id = WAKE_ID + 1;
+
+    // Responses the workers have finished, by connection id
+    std::mutex answered_mtx;
+    std::vector<std::pair<uint64_t, std::string>> answered;
+
+    // Declared last so that its workers are joined before what they use goes away
+    ThreadPool pool(thread_count);
+
+    // Hands the next request of c to the pool, closes c if it is done, and polls it for what it waits on. A connection
+    // has one request with the workers at a time and isn't read until its responses are sent, so responses keep the
+    // order of the requests and a client that doesn't read them can't make the server buffer more.
+    auto advance = [&](uint64_t id, Connection& c) {
+        uint32_t size;
+        if (!c.busy && get_request_size(c.in, size)) {
+            if (size > MAX_REQUEST_SIZE) {
+                close(c.fd);
+                connections.erase(id);
+                return;
+            }
+            if (c.in.size() - 4 >= size) {
+                c.busy = true;
+                pool.submit([this, id, request = c.in.substr(4, size), &answered_mtx, &answered] {
+                    std::string response = answer(request);
+                    {
+                        std::lock_guard<std::mutex> lock(answered_mtx);
+                        answered.emplace_back(id, std::move(response));
+                    }
+                    uint64_t one = 1;
+                    ssize_t r = write(wake_fd, &one, sizeof(one));
+                    (void) r; // only fails if the counter would overflow, and then a wake is pending anyway
+                });
+                c.in.erase(0, 4 + size);
+            }
+        }
+
+        if (c.eof && !c.busy && c.out.empty() && !has_request(c.in)) {
+            close(c.fd);
+            connections.erase(id);
+            return;
+        }
+
+        uint32_t events = 0;
+        if (!c.out.empty()) {
+            events = EPOLLOUT;
+        } else if (!c.busy && !c.eof) {
+            events = EPOLLIN;
+        }
+        if (events != c.events) {
+            epoll_event e{};
+            e.events = events;
+            e.data.u64 = id;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &e) < 0) {
+                close(c.fd);
+                connections.erase(id);
+                return;
+            }
+            c.events = events;
+        }
+    };
+
+    bool accept_paused = false;
+    bool accept_failing = false; // reported once until an accept succeeds
+    std::chrono::steady_clock::time_point accept_resume;
+    epoll_event events[64];
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, 64, accept_paused ? ACCEPT_BACKOFF_MS : -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("can't poll connections: ") + std::strerror(errno));
+        }
+        if (accept_paused && (std::chrono::steady_clock::now() >= accept_resume)) {
+            listen_event.events = EPOLLIN;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &listen_event) == 0) {
+                accept_paused = false;
+            }
+        }
+
+        for (int e_i = 0; e_i < n; e_i++) {
+            uint64_t id = events[e_i].data.u64;
+            if (id == LISTEN_ID) {
+                while (!accept_paused) {
+                    int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                    if (client < 0) {
+                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                            break;
+                        }
+                        if ((errno == EINTR) || (errno == ECONNABORTED)) {
+                            continue;
+                        }
+                        if ((errno != EMFILE) && (errno != ENFILE) && (errno != ENOBUFS) && (errno != ENOMEM)) {
+                            throw std::runtime_error("can't accept connections on " + socket_path + ": " + std::strerror(errno));
+                        }
+                        // The pending connection keeps the socket readable, so stop polling it for a moment
+                        // rather than spinning until a descriptor is freed
+                        if (!accept_failing) {
+                            std::cerr << "Can't accept connections: " << std::strerror(errno) << ", retrying every " << ACCEPT_BACKOFF_MS << " ms" << "\n";
+                            accept_failing = true;
+                        }
+                        listen_event.events = 0;
+                        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &listen_event);
+                        accept_paused = true;
+                        accept_resume = std::chrono::steady_clock::now() + std::chrono::milliseconds(ACCEPT_BACKOFF_MS);
+                        break;
+                    }
+                    if (accept_failing) {
+                        std::cerr << "Accepting connections again" << "\n";
+                        accept_failing = false;
+                    }
+
+                    Connection c;
+                    c.fd = client;
+                    c.events = EPOLLIN;
+                    epoll_event client_event{};
+                    client_event.events = EPOLLIN;
+                    client_event.data.u64 = next_id;
+                    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &client_event) < 0) {
+                        close(client);
+                        continue;
+                    }
+                    connections.emplace(next_id++, std::move(c));
+                }
+                continue;
+            }
+
+            if (id == WAKE_ID) {
+                uint64_t count;
+                ssize_t r = read(wake_fd, &count, sizeof(count));
+                (void) r; // resets the counter, nothing to read only means an earlier wake took these responses
+                std::vector<std::pair<uint64_t, std::string>> ready;
+                {
+                    std::lock_guard<std::mutex> lock(answered_mtx);
+                    ready.swap(answered);
+                }
+                for (auto& [conn_id, response] : ready) {
+                    auto it = connections.find(conn_id);
+                    if (it == connections.end()) {
+                        continue; // closed while it was being answered
+                    }
+                    Connection& c = it->second;
+                    c.busy = false;
+                    append_frame(c.out, response);
+                    if (!flush(c)) {
+                        close(c.fd);
+                        connections.erase(it);
+                        continue;
+                    }
+                    advance(conn_id, c);
+                }
+                continue;
+            }
+
+            auto it = connections.find(id);
+            if (it == connections.end()) {
+                continue; // closed by an earlier event of this batch
+            }
+            Connection& c = it->second;
+            uint32_t ev = events[e_i].events;
+            if ((ev & (EPOLLERR | EPOLLHUP)) || ((ev & EPOLLIN) && !receive(c)) || ((ev & EPOLLOUT) && !flush(c))) {
+                close(c.fd);
+                connections.erase(it);
+                continue;
+            }
+            advance(id, c);
+        }
+    }
+}
+
+std::string LookupServer::answer(std::string_view request) const {
+    std::vector<std::string_view> fields = split_fields(request);
+    std::string_view command = fields[0];
+    if (fields.size() < 2) {
+        return "error missing argument\n";
+    }
+    std::string_view arg = fields[1];
+
+    // Everything below uses this snapshot, even if a reload swaps in another meanwhile
+    LiveDictionary::Reader d = dictionary.read();
+    const TextIndex& index = d->index;
+    const HeadwordTrie& trie = d->trie;
+
+    size_t limit;
+    if (command == "lookup") {
+        std::vector<HeadwordTrie::Match> matches = trie.find(arg);
+        return get_match_lines(matches, matches.size(), false);
+    } else if ((command == "prefix") || (command == "complete")) {
+        if (!get_count(fields, 2, DEFAULT_LIMIT, limit)) {
+            return "error bad limit\n";
+        }
+        std::vector<HeadwordTrie::Match> matches;
+        size_t total;
+        if (command == "prefix") {
+            matches = trie.find_prefix(arg, limit);
+            total = trie.count_prefix(arg);
+        } else {
+            matches = trie.complete(arg, (limit == 0) ? trie.size() : limit);
+            total = matches.size();
+        }
+        return get_match_lines(matches, total, false);
+    } else if (command == "fuzzy") {
+        size_t distance;
+        if (!get_count(fields, 2, DEFAULT_DISTANCE, distance) || (distance > MAX_DISTANCE) || !get_count(fields, 3, DEFAULT_LIMIT, limit)) {
+            return "error bad distance or limit\n";
+        }
+        std::vector<HeadwordTrie::Match> matches = trie.find_fuzzy(arg, distance);
+        size_t total = matches.size();
+        if ((limit > 0) && (limit < matches.size())) {
+            matches.resize(limit);
+        }
+        return get_match_lines(matches, total, true);
+    } else if (command == "query") {
+        if (!get_count(fields, 2, DEFAULT_LIMIT, limit)) {
+            return "error bad limit\n";
+        }
+        std::vector<uint32_t> words = index.search(arg);
+        size_t shown = ((limit == 0) || (limit > words.size())) ? words.size() : limit;
+        std::string out = "ok " + std::to_string(words.size()) + "\n";
+        for (size_t i = 0; i < shown; i++) {
+            append_field(out, index.get_name(words[i]));
+            out += '\t';
+            append_field(out, index.get_category(words[i]));
+            out += '\t';
+            append_field(out, index.get_definition(words[i]));
+            out += '\n';
+        }
+        return out;
+    } else if (command == "entry") {
+        std::string_view format = (fields.size() > 2) ? fields[2] : "text";
+        if ((format != "text") && (format != "html")) {
+            return "error unknown format " + std::string(format) + "\n";
+        }
+        std::vector<HeadwordTrie::Match> matches = trie.find(arg);
+        std::string out = "ok " + std::to_string(matches.size()) + "\n";
+        for (size_t m_i = 0; m_i < matches.size(); m_i++) {
+            if (m_i > 0) {
+                out += '\n';
+            }
+            render_word(*d, matches[m_i].category, matches[m_i].word, format == "html", out);
+        }
+        return out;
+    }
+    return "error unknown command " + std::string(command) + "\n";
+}
+
+void LookupServer::render_word(const DictionarySnapshot& d, std::string_view category, uint32_t word, bool html, std::string& out) {
+    for (const DocxStream::Paragraph& p : d.render(d.get_word(category, word))) {
+        if (html) {
+            out += "<p>";
+        }
+        for (const DocxStream::Text& t : p.texts) {
+            if (!html) {
+                append_field(out, t.content);
+                continue;
+            }
+            out += t.bold ? "<b>" : "";
+            out += t.italic ? "<i>" : "";
+            append_escaped(out, t.content);
+            out += t.italic ? "</i>" : "";
+            out += t.bold ? "</b>" : "";
+        }
+        out += html ? "</p>\n" : "\n";
+    }
+}
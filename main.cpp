@@ -11,40 +11,462 @@ You should have received a copy of the GNU General Public License along with Adi
 */
 
 #include "include/adict.h"
+#include "include/file_watcher.h"
+#include "include/stats.h"
+#include "include/text_index.h"
+#include "include/headword_trie.h"
+#include "include/lookup_server.h"
+#include "include/thread_pool.h"
 #include <string>
+#include <vector>
 #include <iostream>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <fstream>
+#include <mutex>
+
+// Quiet time after the last change to the input before watch mode rebuilds
+const int WATCH_DEBOUNCE_MS = 250;
+
+// Matches printed by query, lookup, complete and fuzzy unless --limit says otherwise
+const size_t QUERY_DEFAULT_LIMIT = 20;
+
+// Edits allowed by fuzzy unless --distance says otherwise
+const size_t FUZZY_DEFAULT_DISTANCE = 2;
+
+enum LookupMode {
+    NAME, // words named name, or starting with it if it ends with *
+    COMPLETE, // shortest names starting with name
+    FUZZY // names at most some edits from name
+};
+
+// Parses a non-negative integer option value, returns false if it isn't one
+static bool parse_count(const std::string& s, size_t& out) {
+    if (s.empty() || (s.find_first_not_of("0123456789") != std::string::npos)) {
+        return false;
+    }
+    out = std::stoul(s);
+    return true;
+}
+
+// Input path with the json extension replaced by docx
+static std::string get_output_path(const std::string& input) {
+    std::string final_fpath_no_json_ext = input;
+    if (input.size() > 5) { // dot and 'json'
+        std::string sub = final_fpath_no_json_ext.substr(final_fpath_no_json_ext.size() - 4, 4);
+        if ((sub == "json") || (sub == "JSON")) {
+            std::string noext = final_fpath_no_json_ext.substr(0, final_fpath_no_json_ext.size() - 5);
+            final_fpath_no_json_ext = noext;
+        }
+    }
+    return final_fpath_no_json_ext + ".docx";
+}
+
+// One build of watch mode, errors are reported and otherwise ignored so that watching goes on
+static void rebuild(const std::string& input, const std::string& oname, size_t thread_count, ParagraphCache& cache) {
+    auto start = std::chrono::steady_clock::now();
+    Stats::reset();
+    try {
+        Adict adict = Adict::load(input);
+        DOCX docx = adict.compile(thread_count, &cache);
+        STATS_SCOPE("save");
+        docx.save(oname);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not build " << input << ": " << e.what() << "\n";
+        return;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Built " << oname << " in " << ms << " ms (" << cache.hits << " words reused, " << cache.misses << " rebuilt)" << std::endl;
+    if (Stats::is_enabled()) {
+        std::cerr << Stats::get_json() << std::endl;
+    }
+}
+
+static int watch(const std::string& input, const std::string& oname, size_t thread_count) {
+    // Editors may truncate the file and write it anew while a rebuild reads it
+    Adict::set_copy_sources(true);
+    FileWatcher watcher(input);
+    if (!watcher.is_open()) {
+        std::cerr << "Could not watch " << input << "\n";
+        return 1;
+    }
+
+    // Paragraphs of unchanged words are kept between builds
+    ParagraphCache cache;
+    while (true) {
+        rebuild(input, oname, thread_count, cache);
+        if (!watcher.wait_for_change(WATCH_DEBOUNCE_MS)) {
+            std::cerr << "Stopped watching " << input << "\n";
+            return 1;
+        }
+    }
+}
+
+// Reads the inputs listed in a batch manifest, one path per line. Blank lines and lines starting with # are skipped,
+// relative paths are taken relative to the manifest.
+static bool read_manifest(const std::string& fpath, std::vector<std::string>& inputs) {
+    std::ifstream f(fpath);
+    if (!f) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(f, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if ((begin == std::string::npos) || (line[begin] == '#')) {
+            continue;
+        }
+        size_t end = line.find_last_not_of(" \t\r");
+        std::filesystem::path input = line.substr(begin, end - begin + 1);
+        if (input.is_relative()) {
+            input = std::filesystem::path(fpath).parent_path() / input;
+        }
+        inputs.push_back(input.string());
+    }
+    return true;
+}
+
+// Builds every input next to itself on one shared pool, one dictionary per task. Only as many dictionaries as
+// there are workers are in memory at a time. A failed input is reported and the others are still built.
+static int batch(const std::vector<std::string>& inputs, size_t thread_count) {
+    std::mutex out_mtx;
+    size_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        ThreadPool pool(thread_count);
+        for (const std::string& input : inputs) {
+            pool.submit([&out_mtx, &failed, &input] {
+                auto file_start = std::chrono::steady_clock::now();
+                std::string oname = get_output_path(input);
+                std::string error;
+                try {
+                    if (!std::filesystem::exists(input)) {
+                        error = "file does not exist";
+                    } else {
+                        Adict adict = Adict::load(input);
+                        DOCX docx = adict.compile(1);
+                        STATS_SCOPE("save");
+                        docx.save(oname);
+                    }
+                } catch (const std::exception& e) {
+                    error = e.what();
+                }
+
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - file_start).count();
+                std::lock_guard<std::mutex> lock(out_mtx);
+                if (error.empty()) {
+                    std::cout << "Built " << oname << " in " << ms << " ms" << std::endl;
+                } else {
+                    std::cerr << "Could not build " << input << ": " << error << std::endl;
+                    failed++;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Built " << (inputs.size() - failed) << " of " << inputs.size() << " dictionaries in " << ms << " ms" << std::endl;
+    if (Stats::is_enabled()) {
+        std::cerr << Stats::get_json() << std::endl;
+    }
+    return (failed == 0) ? 0 : 1;
+}
+
+// Full-text lookup through the index next to the input (built on first use, see TextIndex), prints up to limit
+// matching words (all of them if limit is 0)
+static int query(const std::string& input, const std::string& terms, size_t limit) {
+    if (!std::filesystem::exists(input)) {
+        std::cerr << "File does not exist: " << input << "\n";
+        return 1;
+    }
+
+    TextIndex index;
+    std::vector<uint32_t> matches;
+    try {
+        index = TextIndex::load(input);
+        matches = index.search(terms);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not search " << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    size_t shown = ((limit == 0) || (limit > matches.size())) ? matches.size() : limit;
+    for (size_t i = 0; i < shown; i++) {
+        std::cout << index.get_name(matches[i]);
+        if (index.get_category(matches[i]) != "*") {
+            std::cout << " (" << index.get_category(matches[i]) << ")";
+        }
+        std::cout << ": " << index.get_definition(matches[i]) << "\n";
+    }
+    if (shown < matches.size()) {
+        std::cout << "... and " << (matches.size() - shown) << " more (--limit 0 shows all)" << "\n";
+    }
+
+    if (Stats::is_enabled()) {
+        std::cerr << Stats::get_json() << "\n";
+    }
+    if (matches.empty()) {
+        std::cerr << "No words match " << terms << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Headword lookup through the trie next to the input (built on first use, see HeadwordTrie), prints up to limit
+// matching words (all of them if limit is 0). distance is only used in FUZZY mode.
+static int lookup(const std::string& input, std::string name, LookupMode mode, size_t limit, size_t distance) {
+    if (!std::filesystem::exists(input)) {
+        std::cerr << "File does not exist: " << input << "\n";
+        return 1;
+    }
+
+    std::vector<HeadwordTrie::Match> matches;
+    size_t total = 0;
+    HeadwordTrie trie;
+    try {
+        trie = HeadwordTrie::load(input);
+        STATS_SCOPE("lookup");
+        if (mode == COMPLETE) {
+            matches = trie.complete(name, (limit == 0) ? trie.size() : limit);
+            total = matches.size();
+        } else if (mode == FUZZY) {
+            matches = trie.find_fuzzy(name, distance);
+            total = matches.size();
+            if ((limit > 0) && (limit < matches.size())) {
+                matches.resize(limit);
+            }
+        } else if (!name.empty() && (name.back() == '*')) {
+            name.pop_back();
+            matches = trie.find_prefix(name, limit);
+            total = trie.count_prefix(name);
+        } else {
+            matches = trie.find(name);
+            total = matches.size();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Could not look up " << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    for (const HeadwordTrie::Match& m : matches) {
+        std::cout << m.name;
+        if (m.category != "*") {
+            std::cout << " (" << m.category << ")";
+        }
+        if (mode == FUZZY) {
+            std::cout << " [" << m.distance << "]";
+        }
+        std::cout << "\n";
+    }
+    if (matches.size() < total) {
+        std::cout << "... and " << (total - matches.size()) << " more (--limit 0 shows all)" << "\n";
+    }
+
+    if (Stats::is_enabled()) {
+        std::cerr << Stats::get_json() << "\n";
+    }
+    if (matches.empty()) {
+        std::cerr << "No words match " << name << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Answers lookups on the input over a Unix domain socket until the process is stopped, see LookupServer
+static int serve(const std::string& input, const std::string& socket_path, size_t thread_count) {
+    if (!std::filesystem::exists(input)) {
+        std::cerr << "File does not exist: " << input << "\n";
+        return 1;
+    }
+
+    Adict::set_copy_sources(true); // the JSON is reloaded when it changes, see watch
+    try {
+        LookupServer server(input);
+        server.listen(socket_path);
+        std::cerr << "Serving " << input << " on " << socket_path << "\n";
+        server.serve(thread_count);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not serve " << input << ": " << e.what() << "\n";
+    }
+    return 1;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    size_t thread_count = 1;
+    bool thread_count_given = false;
+    bool watch_mode = false;
+    bool batch_mode = false;
+    bool pipeline_mode = false;
+    bool stream_mode = false;
+    std::vector<std::string> manifest_inputs;
+    bool print_mode = true;
+    size_t query_limit = QUERY_DEFAULT_LIMIT;
+    size_t fuzzy_distance = FUZZY_DEFAULT_DISTANCE;
+    std::string socket_path;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-j") || (arg == "--threads")) {
+            if ((i + 1 >= argc) || !parse_count(argv[i + 1], thread_count)) {
+                std::cerr << "Please provide a thread count after " << arg << " (0 for automatic)" << "\n";
+                return 1;
+            }
+            thread_count_given = true;
+            i++;
+        } else if ((arg == "-b") || (arg == "--batch")) {
+            batch_mode = true;
+        } else if (arg == "--manifest") {
+            if ((i + 1 >= argc) || !read_manifest(argv[i + 1], manifest_inputs)) {
+                std::cerr << "Please provide a readable manifest file after " << arg << "\n";
+                return 1;
+            }
+            batch_mode = true;
+            i++;
+        } else if ((arg == "-p") || (arg == "--pipeline")) {
+            pipeline_mode = true;
+        } else if ((arg == "-s") || (arg == "--stream")) {
+            stream_mode = true;
+        } else if ((arg == "-w") || (arg == "--watch")) {
+            watch_mode = true;
+        } else if (arg == "--print") {
+            print_mode = true;
+        } else if ((arg == "-q") || (arg == "--quiet")) {
+            print_mode = false;
+        } else if (arg == "--limit") {
+            if ((i + 1 >= argc) || !parse_count(argv[i + 1], query_limit)) {
+                std::cerr << "Please provide a number of matches after " << arg << " (0 for all)" << "\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--distance") {
+            if ((i + 1 >= argc) || !parse_count(argv[i + 1], fuzzy_distance)) {
+                std::cerr << "Please provide a number of edits after " << arg << "\n";
+                return 1;
+            }
+            i++;
+        } else if (arg == "--socket") {
+            if (i + 1 >= argc) {
+                std::cerr << "Please provide a socket path after " << arg << "\n";
+                return 1;
+            }
+            socket_path = argv[i + 1];
+            i++;
+        } else if (arg == "--stats") {
+            if (!Stats::enable()) {
+                std::cerr << "This build of adict has no stats support (built with ADICT_NO_STATS)" << "\n";
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (!args.empty() && (args[0] == "query")) {
+        if (args.size() < 3) {
+            std::cerr << "Please provide the adict JSON file and the terms to look up (adict query dict.json \"term\")" << "\n";
+            return 1;
+        }
+        std::string terms = args[2];
+        for (size_t i = 3; i < args.size(); i++) {
+            terms += " " + args[i];
+        }
+        return query(args[1], terms, query_limit);
+    }
+
+    if (!args.empty() && ((args[0] == "lookup") || (args[0] == "complete") || (args[0] == "fuzzy"))) {
+        if (args.size() < 3) {
+            std::cerr << "Please provide the adict JSON file and the name to look up (adict " << args[0] << " dict.json name)" << "\n";
+            return 1;
+        }
+        LookupMode mode = (args[0] == "complete") ? COMPLETE : ((args[0] == "fuzzy") ? FUZZY : NAME);
+        return lookup(args[1], args[2], mode, query_limit, fuzzy_distance);
+    }
+
+    if (!args.empty() && (args[0] == "serve")) {
+        if ((args.size() < 2) || socket_path.empty()) {
+            std::cerr << "Please provide the adict JSON file and a socket path (adict serve dict.json --socket PATH)" << "\n";
+            return 1;
+        }
+        return serve(args[1], socket_path, thread_count_given ? thread_count : 0);
+    }
+
+    if (batch_mode) {
+        if (watch_mode) {
+            std::cerr << "Batch mode and watch mode can't be combined" << "\n";
+            return 1;
+        }
+        args.insert(args.end(), manifest_inputs.begin(), manifest_inputs.end());
+        if (args.empty()) {
+            std::cerr << "Please provide the adict JSON files to build" << "\n";
+            return 1;
+        }
+        return batch(args, thread_count_given ? thread_count : 0);
+    }
+
+    if (args.size() < 1) {
         std::cerr << "Please provide the adict JSON file path as an argument" << "\n";
         return 1;
     }
 
-    if (!std::filesystem::exists(argv[1])) {
-        std::cerr << "File does not exist: " << argv[1] << "\n";
+    if (!std::filesystem::exists(args[0])) {
+        std::cerr << "File does not exist: " << args[0] << "\n";
         return 1;
     }
 
-    Adict adict = Adict::read(argv[1]);
-    adict.print();
-
     std::string oname;
-    if (argc >= 3) {
-        oname = argv[2];
+    if (args.size() >= 2) {
+        oname = args[1];
     } else {
-        std::string argv1 = argv[1];
-        std::string final_fpath_no_json_ext = argv1;
-        if (argv1.size() > 5) { // dot and 'json'
-            std::string sub = final_fpath_no_json_ext.substr(final_fpath_no_json_ext.size() - 4, 4);
-            if ((sub == "json") || (sub == "JSON")) {
-                std::string noext = final_fpath_no_json_ext.substr(0, final_fpath_no_json_ext.size() - 5);
-                final_fpath_no_json_ext = noext;
-            }
+        oname = get_output_path(args[0]);
+    }
+
+    if (watch_mode) {
+        return watch(args[0], oname, thread_count);
+    }
+
+    if (stream_mode && pipeline_mode) {
+        std::cerr << "Stream mode and pipeline mode can't be combined" << "\n";
+        return 1;
+    }
+
+    Adict adict;
+    DOCX docx;
+    if (pipeline_mode) {
+        // Parsing and building overlap instead, so the dictionary can only be printed afterwards
+        docx = adict.read_and_compile(args[0], thread_count_given ? thread_count : 0);
+        if (print_mode) {
+            adict.print();
+        }
+    } else {
+        adict = Adict::load(args[0]);
+
+        // The console dump only reads the dictionary, so it is written while the document is being built
+        std::future<void> printing;
+        if (print_mode) {
+            printing = std::async(std::launch::async, [&adict] { adict.print(); });
+        }
+        if (stream_mode) {
+            adict.write_docx(oname, thread_count);
+        } else {
+            docx = adict.compile(thread_count);
+        }
+        if (printing.valid()) {
+            printing.get();
         }
-        oname = final_fpath_no_json_ext + ".docx";
     }
 
-    adict.compile().save(oname);
+    if (!stream_mode) {
+        STATS_SCOPE("save");
+        docx.save(oname);
+    }
+
+    if (Stats::is_enabled()) {
+        std::cerr << Stats::get_json() << "\n";
+    }
 
     return 0;
-}
\ No newline at end of file
+}
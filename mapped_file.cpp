@@ -0,0 +1,80 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/mapped_file.h"
+
+// System includes
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Standard includes
+#include <cerrno>
+
+MappedFile::MappedFile(const std::string& fpath, bool copy) {
+    int fd = open(fpath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (copy && (fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        // The file may shrink or grow while it's read, what was read is kept
+        buffer.resize(st.st_size);
+        size_t got = 0;
+        while (got < buffer.size()) {
+            ssize_t r = read(fd, buffer.data() + got, buffer.size() - got);
+            if ((r < 0) && (errno == EINTR)) {
+                continue;
+            }
+            if (r <= 0) {
+                break;
+            }
+            got += r;
+        }
+        if (got > 0) {
+            buffer.resize(got);
+            ptr = buffer.data();
+            len = got;
+        }
+    } else if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            ptr = static_cast<const char*>(p);
+            len = st.st_size;
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if ((ptr != nullptr) && buffer.empty()) {
+        munmap(const_cast<char*>(ptr), len);
+    }
+}
+
+bool MappedFile::is_open() const {
+    return ptr != nullptr;
+}
+
+const char* MappedFile::data() const {
+    return ptr;
+}
+
+size_t MappedFile::size() const {
+    return len;
+}
@@ -0,0 +1,94 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/paragraph_cache.h"
+#include "include/hash.h"
+
+// Standard includes
+#include <utility> // for move
+
+namespace {
+
+// Strings are length prefixed so that moving text between fields changes the hash
+uint64_t hash_string(std::string_view s, uint64_t h) {
+    uint64_t len = s.size();
+    h = fnv1a(&len, sizeof(len), h);
+    return fnv1a(s.data(), s.size(), h);
+}
+
+uint64_t hash_list(const WordTable::List& v, uint64_t h) {
+    uint64_t n = v.size();
+    h = fnv1a(&n, sizeof(n), h);
+    for (size_t i = 0; i < v.size(); i++) {
+        h = hash_string(v[i], h);
+    }
+    return h;
+}
+
+} // namespace
+
+uint64_t ParagraphCache::get_word_hash(const WordTable::WordView& w, uint64_t format_hash) {
+    uint64_t h = fnv1a(&format_hash, sizeof(format_hash));
+    h = hash_string(w.name, h);
+    h = hash_string(w.definition, h);
+    h = hash_list(w.etymology, h);
+    h = hash_list(w.examples, h);
+    h = hash_list(w.example_sentences, h);
+    h = hash_list(w.inspirations, h);
+    h = hash_list(w.notes, h);
+
+    uint64_t n = w.extra_fields.size();
+    h = fnv1a(&n, sizeof(n), h);
+    for (size_t f_i = 0; f_i < w.extra_fields.size(); f_i++) {
+        h = hash_string(w.extra_fields.get_key(f_i), h);
+        h = hash_list(w.extra_fields.get(f_i), h);
+    }
+    return h;
+}
+
+const std::vector<DOCX::Paragraph>* ParagraphCache::find(uint64_t hash) const {
+    auto it = entries.find(hash);
+    if (it == entries.end()) {
+        return nullptr;
+    }
+    return &it->second.paragraphs;
+}
+
+const std::vector<DOCX::Paragraph>* ParagraphCache::insert(uint64_t hash, std::vector<DOCX::Paragraph> paragraphs) {
+    Entry& e = entries[hash];
+    e.paragraphs = std::move(paragraphs);
+    e.used = true;
+    return &e.paragraphs;
+}
+
+void ParagraphCache::mark_used(uint64_t hash) {
+    auto it = entries.find(hash);
+    if (it != entries.end()) {
+        it->second.used = true;
+    }
+}
+
+void ParagraphCache::prune() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (!it->second.used) {
+            it = entries.erase(it);
+        } else {
+            it->second.used = false;
+            it++;
+        }
+    }
+}
+
+size_t ParagraphCache::size() const {
+    return entries.size();
+}
@@ -0,0 +1,213 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/stats.h"
+
+// Library include
+#include "include/json.hpp"
+using json = nlohmann::json;
+
+// Standard includes
+#include <atomic>
+#include <chrono>
+#include <cstdlib> // for malloc and free
+#include <map>
+#include <mutex>
+#include <new>
+
+#ifndef ADICT_NO_STATS
+
+namespace {
+
+std::atomic<bool> enabled{false};
+
+// Allocations of one thread. Only its thread writes the count, so counting is a plain increment rather than an
+// atomic read-modify-write on a counter every thread shares. The counters of the live threads are linked together
+// (without allocating, this runs inside operator new) for get_allocation_count to add up.
+struct ThreadCounter {
+    std::atomic<uint64_t> allocations{0};
+    ThreadCounter* prev = nullptr;
+    ThreadCounter* next = nullptr;
+
+    ThreadCounter();
+    ~ThreadCounter();
+};
+
+std::mutex counters_mtx;
+ThreadCounter* counters = nullptr;
+uint64_t retired_allocations = 0; // of the threads that have ended
+
+ThreadCounter::ThreadCounter() {
+    std::lock_guard<std::mutex> lock(counters_mtx);
+    next = counters;
+    if (next != nullptr) {
+        next->prev = this;
+    }
+    counters = this;
+}
+
+ThreadCounter::~ThreadCounter() {
+    std::lock_guard<std::mutex> lock(counters_mtx);
+    retired_allocations += allocations.load(std::memory_order_relaxed);
+    if (prev != nullptr) {
+        prev->next = next;
+    } else {
+        counters = next;
+    }
+    if (next != nullptr) {
+        next->prev = prev;
+    }
+}
+
+// Per thread so that a scope only sees the allocations of its own thread
+thread_local ThreadCounter thread_allocations;
+thread_local uint64_t thread_allocated_bytes = 0;
+
+struct Stage {
+    uint64_t calls = 0;
+    int64_t ns = 0;
+    uint64_t items = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+};
+
+std::mutex stages_mtx;
+std::map<std::string, Stage> stages;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// Allocation counting
+
+void* operator new(size_t size) {
+    thread_allocations.allocations.store(thread_allocations.allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    thread_allocated_bytes += size;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Methods
+
+bool Stats::enable() {
+    enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool Stats::is_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Stats::reset() {
+    std::lock_guard<std::mutex> lock(stages_mtx);
+    stages.clear();
+}
+
+uint64_t Stats::get_allocation_count() {
+    std::lock_guard<std::mutex> lock(counters_mtx);
+    uint64_t total = retired_allocations;
+    for (ThreadCounter* c = counters; c != nullptr; c = c->next) {
+        total += c->allocations.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::string Stats::get_json() {
+    json report;
+    report["stages"] = json::object();
+    {
+        std::lock_guard<std::mutex> lock(stages_mtx);
+        for (const auto& [name, stage] : stages) {
+            json& s = report["stages"][name];
+            s["calls"] = stage.calls;
+            s["ms"] = stage.ns / 1e6;
+            s["items"] = stage.items;
+            s["allocations"] = stage.allocations;
+            s["allocated_bytes"] = stage.allocated_bytes;
+        }
+    }
+    report["allocations"] = get_allocation_count();
+    return report.dump(2);
+}
+
+Stats::Scope::Scope(const char* name, size_t items) : name(name), items(items), active(Stats::is_enabled()) {
+    if (active) {
+        start_allocations = thread_allocations.allocations.load(std::memory_order_relaxed);
+        start_bytes = thread_allocated_bytes;
+        start_ns = now_ns();
+    }
+}
+
+Stats::Scope::~Scope() {
+    if (!active) {
+        return;
+    }
+
+    int64_t ns = now_ns() - start_ns;
+    uint64_t allocations = thread_allocations.allocations.load(std::memory_order_relaxed) - start_allocations;
+    uint64_t bytes = thread_allocated_bytes - start_bytes;
+
+    std::lock_guard<std::mutex> lock(stages_mtx);
+    Stage& stage = stages[name];
+    stage.calls++;
+    stage.ns += ns;
+    stage.items += items;
+    stage.allocations += allocations;
+    stage.allocated_bytes += bytes;
+}
+
+#else
+
+bool Stats::enable() {
+    return false;
+}
+
+bool Stats::is_enabled() {
+    return false;
+}
+
+void Stats::reset() {}
+
+uint64_t Stats::get_allocation_count() {
+    return 0;
+}
+
+std::string Stats::get_json() {
+    return "{}";
+}
+
+#endif
@@ -0,0 +1,459 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Index block (.adictidx) layout, all integers in native byte order:
+
+    IndexHeader
+    uint32_t docs[doc_count * 3]             category, name and definition of each word, as string ids
+    uint32_t terms[term_count * 3]           string id, offset in postings and word count of each term, sorted by term
+    uint32_t string_offsets[string_count+1]  string i is blob[offsets[i], offsets[i+1])
+    char blob[blob_size]
+    uint8_t postings[postings_size]          word numbers of each term, the first as is and the others as the
+                                             difference to the previous one, as LEB128 varints
+*/
+
+// Program includes
+#include "include/text_index.h"
+#include "include/utf8.h"
+#include "include/stats.h"
+
+// Standard includes
+#include <algorithm> // for sort and set_intersection
+#include <cstring> // for memcmp and memcpy
+#include <iterator> // for back_inserter
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility> // for move and pair
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'A', 'D', 'I', 'C', 'T', 'I', 'D', 'X'};
+const uint32_t INDEX_VERSION = 2;
+const uint32_t INDEX_BYTE_ORDER = 0x01020304;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime; // nanoseconds
+    uint64_t source_hash;
+    uint64_t doc_count;
+    uint64_t term_count;
+    uint64_t string_count;
+    uint64_t blob_size;
+    uint64_t postings_size;
+};
+
+// Strings of an index block being built
+class StringTable {
+public:
+    std::vector<uint32_t> offsets{0};
+    std::string blob;
+
+    uint32_t add(std::string_view s) {
+        if (blob.size() + s.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("Dictionary text over 4 GiB");
+        }
+        blob += s;
+        offsets.push_back(blob.size());
+        return offsets.size() - 2;
+    }
+};
+
+void append_varint(std::vector<unsigned char>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+// Letters, digits and combining marks make up terms, everything else separates them
+bool is_term_char(uint32_t cp) {
+    if (cp < 0x80) {
+        return ((cp >= '0') && (cp <= '9')) || ((cp >= 'a') && (cp <= 'z')) || ((cp >= 'A') && (cp <= 'Z'));
+    }
+    if ((cp == 0xAA) || (cp == 0xB5) || (cp == 0xBA)) {
+        return true;
+    }
+    return !(((cp >= 0x80) && (cp <= 0xBF)) || (cp == 0xD7) || (cp == 0xF7) ||
+        (cp == 0x037E) || (cp == 0x0387) || (cp == 0x060C) || (cp == 0x061B) || (cp == 0x061F) ||
+        ((cp >= 0x066A) && (cp <= 0x066D)) || (cp == 0x06D4) || (cp == 0x0964) || (cp == 0x0965) ||
+        ((cp >= 0x2000) && (cp <= 0x2BFF)) || ((cp >= 0x3000) && (cp <= 0x303F)) || (cp == 0x30FB) ||
+        ((cp >= 0xFF01) && (cp <= 0xFF0F)) || (cp == 0xFFFD));
+}
+
+// Lower case of Latin, Greek and Cyrillic letters, other code points are returned as they are
+uint32_t fold_case(uint32_t cp) {
+    if ((cp >= 'A') && (cp <= 'Z')) {
+        return cp + ('a' - 'A');
+    } else if (cp < 0xC0) {
+        return cp;
+    } else if ((cp <= 0xDE) && (cp != 0xD7)) {
+        return cp + 0x20;
+    } else if (((cp >= 0x0100) && (cp <= 0x0137)) || ((cp >= 0x014A) && (cp <= 0x0177))) {
+        return cp | 1;
+    } else if (((cp >= 0x0139) && (cp <= 0x0148)) || ((cp >= 0x0179) && (cp <= 0x017E))) {
+        return (cp % 2 == 1) ? cp + 1 : cp;
+    } else if (cp == 0x0178) {
+        return 0x00FF;
+    } else if (((cp >= 0x0391) && (cp <= 0x03A9)) || ((cp >= 0x0410) && (cp <= 0x042F))) {
+        return cp + 0x20;
+    } else if (cp == 0x0386) {
+        return 0x03AC;
+    } else if ((cp >= 0x0388) && (cp <= 0x038A)) {
+        return cp + 0x25;
+    } else if (cp == 0x038C) {
+        return 0x03CC;
+    } else if ((cp == 0x038E) || (cp == 0x038F)) {
+        return cp + 0x3F;
+    } else if (cp == 0x03C2) { // final sigma
+        return 0x03C3;
+    } else if ((cp >= 0x0400) && (cp <= 0x040F)) {
+        return cp + 0x50;
+    }
+    return cp;
+}
+
+} // namespace
+
+// Building
+
+TextIndex TextIndex::build(const Adict& adict) {
+    STATS_SCOPE("index/build");
+    StringTable strings;
+    std::vector<uint32_t> docs;
+
+    std::unordered_map<std::string, uint32_t> term_ids;
+    std::vector<std::vector<uint32_t>> term_docs; // by term id
+    std::vector<std::string> tokens; // reused for every field
+
+    uint32_t doc = 0;
+    for (const auto& [category, ids] : adict.words_by_category) {
+        uint32_t category_id = strings.add(category);
+        for (uint32_t id : ids) {
+            WordTable::WordView w = adict.words.get(id);
+            docs.push_back(category_id);
+            docs.push_back(strings.add(w.name));
+            docs.push_back(strings.add(w.definition));
+
+            tokens.clear();
+            tokenize(w.definition, tokens);
+            for (const WordTable::List* field : {&w.examples, &w.example_sentences, &w.notes}) {
+                for (size_t i = 0; i < field->size(); i++) {
+                    tokenize((*field)[i], tokens);
+                }
+            }
+
+            for (std::string& token : tokens) {
+                auto [it, added] = term_ids.try_emplace(std::move(token), term_docs.size());
+                if (added) {
+                    term_docs.emplace_back();
+                }
+                std::vector<uint32_t>& d = term_docs[it->second];
+                if (d.empty() || (d.back() != doc)) {
+                    d.push_back(doc);
+                }
+            }
+            doc++;
+        }
+    }
+
+    // Terms are looked up by binary search, so they go in byte order
+    std::vector<std::pair<std::string_view, uint32_t>> sorted_terms;
+    sorted_terms.reserve(term_ids.size());
+    for (const auto& [term, id] : term_ids) {
+        sorted_terms.emplace_back(term, id);
+    }
+    std::sort(sorted_terms.begin(), sorted_terms.end());
+
+    std::vector<uint32_t> terms;
+    std::vector<unsigned char> postings;
+    terms.reserve(sorted_terms.size() * 3);
+    for (const auto& [term, id] : sorted_terms) {
+        if (postings.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("Index over 4 GiB");
+        }
+        terms.push_back(strings.add(term));
+        terms.push_back(postings.size());
+        terms.push_back(term_docs[id].size());
+
+        uint32_t prev = 0;
+        for (uint32_t d : term_docs[id]) {
+            append_varint(postings, d - prev);
+            prev = d;
+        }
+    }
+
+    IndexHeader header = {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.byte_order = INDEX_BYTE_ORDER;
+    header.doc_count = doc;
+    header.term_count = sorted_terms.size();
+    header.string_count = strings.offsets.size() - 1;
+    header.blob_size = strings.blob.size();
+    header.postings_size = postings.size();
+
+    TextIndex index;
+    std::vector<char>& block = index.owned;
+    block.reserve(sizeof(IndexHeader) + (docs.size() + terms.size() + strings.offsets.size()) * sizeof(uint32_t) + strings.blob.size() + postings.size());
+    auto append = [&block](const void* data, size_t size) {
+        block.insert(block.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    append(&header, sizeof(IndexHeader));
+    append(docs.data(), docs.size() * sizeof(uint32_t));
+    append(terms.data(), terms.size() * sizeof(uint32_t));
+    append(strings.offsets.data(), strings.offsets.size() * sizeof(uint32_t));
+    append(strings.blob.data(), strings.blob.size());
+    append(postings.data(), postings.size());
+    index.attach(block.data(), block.size());
+    return index;
+}
+
+void TextIndex::tokenize(std::string_view text, std::vector<std::string>& terms) {
+    std::string term;
+    size_t i = 0;
+    while (i < text.size()) {
+        uint32_t cp = next_code_point(text, i);
+        if (is_term_char(cp)) {
+            append_code_point(term, fold_case(cp));
+        } else if (!term.empty()) {
+            terms.push_back(std::move(term));
+            term.clear();
+        }
+    }
+    if (!term.empty()) {
+        terms.push_back(std::move(term));
+    }
+}
+
+// Files
+
+TextIndex TextIndex::load(std::string fpath) {
+    TextIndex index;
+    if (open(fpath, index)) {
+        return index;
+    }
+
+    // Key the index before reading so that an edit made meanwhile leaves it stale
+    Adict::CacheKey key;
+    bool key_ok = Adict::get_cache_key(fpath, key);
+    index = build(Adict::load(fpath));
+    if (key_ok) {
+        index.save(fpath, key);
+    }
+    return index;
+}
+
+std::string TextIndex::get_index_path(std::string fpath) {
+    return Adict::get_derived_path(fpath, ".adictidx");
+}
+
+bool TextIndex::open(std::string fpath, TextIndex& index) {
+    STATS_SCOPE("index/open");
+    std::unique_ptr<MappedFile> mf = std::make_unique<MappedFile>(get_index_path(fpath));
+    if (!mf->is_open() || (mf->size() < sizeof(IndexHeader))) {
+        return false;
+    }
+
+    IndexHeader header;
+    std::memcpy(&header, mf->data(), sizeof(IndexHeader));
+    Adict::CacheKey key;
+    key.size = header.source_size;
+    key.mtime = header.source_mtime;
+    key.hash = header.source_hash;
+    if (!Adict::is_source_unchanged(fpath, key, get_index_path(fpath))) {
+        return false;
+    }
+
+    TextIndex result;
+    if (!result.attach(mf->data(), mf->size())) {
+        return false;
+    }
+    result.mapped = std::move(mf);
+    index = std::move(result);
+    return true;
+}
+
+void TextIndex::save(std::string fpath, const Adict::CacheKey& key) const {
+    IndexHeader header;
+    std::memcpy(&header, owned.data(), sizeof(IndexHeader));
+    header.source_size = key.size;
+    header.source_mtime = key.mtime;
+    header.source_hash = key.hash;
+
+    Adict::write_derived_file(get_index_path(fpath), {
+        std::string_view(reinterpret_cast<const char*>(&header), sizeof(IndexHeader)),
+        std::string_view(owned.data() + sizeof(IndexHeader), owned.size() - sizeof(IndexHeader))
+    }, "index");
+}
+
+bool TextIndex::attach(const char* data, size_t size) {
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(IndexHeader));
+    if ((std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) || (header.version != INDEX_VERSION) || (header.byte_order != INDEX_BYTE_ORDER)) {
+        return false;
+    }
+
+    uint64_t body_size = size - sizeof(IndexHeader);
+    if ((header.doc_count > body_size / 12) || (header.term_count > body_size / 12) || (header.string_count >= body_size / 4) ||
+        (header.blob_size > body_size) || (header.postings_size > body_size) ||
+        ((header.doc_count * 3 + header.term_count * 3 + header.string_count + 1) * 4 + header.blob_size + header.postings_size != body_size)) {
+        return false;
+    }
+
+    const uint32_t* d = reinterpret_cast<const uint32_t*>(data + sizeof(IndexHeader));
+    const uint32_t* t = d + header.doc_count * 3;
+    const uint32_t* o = t + header.term_count * 3;
+    const char* b = reinterpret_cast<const char*>(o + header.string_count + 1);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(b + header.blob_size);
+
+    // Everything is checked once here so lookups don't have to
+    for (uint64_t i = 0; i < header.string_count; i++) {
+        if ((o[i] > o[i + 1]) || (o[i + 1] > header.blob_size)) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.doc_count * 3; i++) {
+        if (d[i] >= header.string_count) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.term_count; i++) {
+        if ((t[i * 3] >= header.string_count) || (t[i * 3 + 1] > header.postings_size) || (t[i * 3 + 2] > header.doc_count)) {
+            return false;
+        }
+    }
+
+    docs = d;
+    terms = t;
+    string_offsets = o;
+    blob = b;
+    postings = p;
+    doc_count = header.doc_count;
+    term_count = header.term_count;
+    string_count = header.string_count;
+    blob_size = header.blob_size;
+    postings_size = header.postings_size;
+    return true;
+}
+
+// Queries
+
+std::vector<uint32_t> TextIndex::search(std::string_view query) const {
+    STATS_SCOPE("query");
+    std::vector<std::string> query_terms;
+    tokenize(query, query_terms);
+    if (query_terms.empty()) {
+        return {};
+    }
+
+    std::vector<size_t> found;
+    for (const std::string& term : query_terms) {
+        size_t t;
+        if (!find_term(term, t)) {
+            return {};
+        }
+        found.push_back(t);
+    }
+
+    // Intersect starting from the rarest term so the candidates only shrink
+    std::sort(found.begin(), found.end(), [this](size_t a, size_t b) {
+        return terms[a * 3 + 2] < terms[b * 3 + 2];
+    });
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    std::vector<uint32_t> result;
+    std::vector<uint32_t> other;
+    std::vector<uint32_t> kept;
+    decode_postings(found[0], result);
+    for (size_t i = 1; (i < found.size()) && !result.empty(); i++) {
+        other.clear();
+        kept.clear();
+        decode_postings(found[i], other);
+        std::set_intersection(result.begin(), result.end(), other.begin(), other.end(), std::back_inserter(kept));
+        result.swap(kept);
+    }
+    return result;
+}
+
+size_t TextIndex::size() const {
+    return doc_count;
+}
+
+std::string_view TextIndex::get_category(uint32_t word) const {
+    return get_string(docs[word * 3]);
+}
+
+std::string_view TextIndex::get_name(uint32_t word) const {
+    return get_string(docs[word * 3 + 1]);
+}
+
+std::string_view TextIndex::get_definition(uint32_t word) const {
+    return get_string(docs[word * 3 + 2]);
+}
+
+// Helpers
+
+std::string_view TextIndex::get_string(uint32_t id) const {
+    return std::string_view(blob + string_offsets[id], string_offsets[id + 1] - string_offsets[id]);
+}
+
+bool TextIndex::find_term(std::string_view term, size_t& t) const {
+    size_t lo = 0;
+    size_t hi = term_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (get_string(terms[mid * 3]) < term) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if ((lo < term_count) && (get_string(terms[lo * 3]) == term)) {
+        t = lo;
+        return true;
+    }
+    return false;
+}
+
+void TextIndex::decode_postings(size_t t, std::vector<uint32_t>& out) const {
+    size_t pos = terms[t * 3 + 1];
+    uint32_t count = terms[t * 3 + 2];
+    uint64_t doc = 0;
+    out.reserve(out.size() + count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t delta = 0;
+        int shift = 0;
+        while (true) {
+            // A malformed list ends early rather than reading past the block
+            if ((pos >= postings_size) || (shift > 28)) {
+                return;
+            }
+            unsigned char byte = postings[pos++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        doc += delta;
+        if (doc >= doc_count) {
+            return;
+        }
+        out.push_back(static_cast<uint32_t>(doc));
+    }
+}
@@ -0,0 +1,104 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/thread_pool.h"
+
+// Standard includes
+#include <utility> // for move
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = ThreadPool::get_default_thread_count();
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    task_cv.notify_all();
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back(std::move(task));
+        pending++;
+    }
+    task_cv.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    done_cv.wait(lock, [this] { return pending == 0; });
+
+    if (first_exception) {
+        std::exception_ptr e = first_exception;
+        first_exception = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+size_t ThreadPool::size() {
+    return workers.size();
+}
+
+size_t ThreadPool::get_default_thread_count() {
+    size_t n = std::thread::hardware_concurrency();
+    if (n == 0) {
+        n = 1;
+    }
+    return n;
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            task_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return; // stopping and nothing left to run
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        std::exception_ptr e;
+        try {
+            task();
+        } catch (...) {
+            e = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (e && !first_exception) {
+                first_exception = e;
+            }
+            pending--;
+            if (pending == 0) {
+                done_cv.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,185 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/word_renderer.h"
+#include "include/hash.h"
+
+// Standard includes
+#include <string_view>
+#include <utility> // for move
+
+namespace {
+
+struct BuiltinField {
+    const char* key;
+    WordTable::ListField list;
+    const char* label;
+    const char* quote;
+};
+
+const BuiltinField BUILTIN_FIELDS[] = {
+    {"etymology", WordTable::ETYMOLOGY, "etym.", ""},
+    {"examples", WordTable::EXAMPLES, "ex.", ""},
+    {"example_sentences", WordTable::EXAMPLE_SENTENCES, "ex.s.", "\""},
+    {"inspirations", WordTable::INSPIRATIONS, "inspirations", ""},
+    {"notes", WordTable::NOTES, "notes", ""}
+};
+
+// Type word text is passed to a document as: DOCX copies it from a std::string, DocxStream takes a view of the table
+template<class Document>
+struct TextString {
+    using type = std::string;
+};
+
+template<>
+struct TextString<DocxStream> {
+    using type = std::string_view;
+};
+
+uint64_t hash_string(const std::string& s, uint64_t h) {
+    uint64_t len = s.size();
+    h = fnv1a(&len, sizeof(len), h);
+    return fnv1a(s.data(), s.size(), h);
+}
+
+} // namespace
+
+bool FieldFormat::operator==(const FieldFormat& other) const {
+    return (key == other.key) && (label == other.label) && (separator == other.separator) && (quote == other.quote);
+}
+
+template<class Document>
+WordRenderer<Document>::WordRenderer(const std::vector<FieldFormat>& configured_fields, size_t global_font_size) {
+    subsize = global_font_size - 1;
+    if (global_font_size <= 1) {
+        subsize = 1;
+    }
+
+    std::vector<FieldFormat> formats;
+    std::vector<int> lists;
+    for (const BuiltinField& b : BUILTIN_FIELDS) {
+        FieldFormat f;
+        f.key = b.key;
+        f.label = b.label;
+        f.quote = b.quote;
+        formats.push_back(f);
+        lists.push_back(b.list);
+    }
+    for (const FieldFormat& c : configured_fields) {
+        bool replaced = false;
+        for (FieldFormat& f : formats) {
+            if (f.key == c.key) {
+                f = c;
+                replaced = true;
+            }
+        }
+        if (!replaced) {
+            formats.push_back(c);
+            lists.push_back(-1);
+        }
+    }
+
+    uint64_t size = global_font_size;
+    format_hash = fnv1a(&size, sizeof(size));
+    for (size_t f_i = 0; f_i < formats.size(); f_i++) {
+        const FieldFormat& f = formats[f_i];
+        format_hash = hash_string(f.key, format_hash);
+        format_hash = hash_string(f.label, format_hash);
+        format_hash = hash_string(f.separator, format_hash);
+        format_hash = hash_string(f.quote, format_hash);
+
+        Text label(f.label);
+        label.size = subsize;
+        label.italic = true;
+
+        Text colon(":");
+        colon.size = subsize;
+
+        Text separator(f.separator);
+        separator.size = subsize;
+
+        Text quote(f.quote);
+        quote.size = subsize;
+
+        fields.push_back(Field{f.key, lists[f_i], label, colon, separator, quote, !f.separator.empty(), !f.quote.empty()});
+    }
+}
+
+template<class Document>
+std::vector<typename Document::Paragraph> WordRenderer<Document>::render(const WordTable::WordView& w) const {
+    using String = typename TextString<Document>::type;
+
+    auto get_entries = [&w](const Field& f) {
+        return (f.list >= 0) ? w.get_list(static_cast<WordTable::ListField>(f.list)) : w.extra_fields.find(f.key);
+    };
+
+    size_t line_count = 1;
+    for (const Field& f : fields) {
+        line_count += !get_entries(f).empty();
+    }
+    std::vector<Paragraph> vp;
+    vp.reserve(line_count);
+
+    // First line (name and definition)
+    Paragraph p;
+    p.add_bold_text(String(w.name));
+    p.add_bold_text(":");
+    p.add_space();
+    p.add_plain_text(String(w.definition));
+    vp.push_back(std::move(p));
+
+    // A line for each field the word has
+    for (const Field& f : fields) {
+        WordTable::List entries = get_entries(f);
+        if (entries.empty()) {
+            continue;
+        }
+
+        Paragraph lp;
+        lp.add_text(f.label);
+        lp.add_text(f.colon);
+        lp.add_space(1, subsize);
+
+        for (size_t e_i = 0; e_i < entries.size(); e_i++) {
+            if (f.has_quote) {
+                lp.add_text(f.quote);
+            }
+
+            Text content(String(entries[e_i]));
+            content.size = subsize;
+            lp.add_text(std::move(content));
+
+            if (f.has_quote) {
+                lp.add_text(f.quote);
+            }
+
+            if (e_i < entries.size()-1) {
+                if (f.has_separator) {
+                    lp.add_text(f.separator);
+                }
+                lp.add_space(1, subsize);
+            }
+        }
+
+        vp.push_back(std::move(lp));
+    }
+    return vp;
+}
+
+template<class Document>
+uint64_t WordRenderer<Document>::get_format_hash() const {
+    return format_hash;
+}
+
+template class WordRenderer<DOCX>;
+template class WordRenderer<DocxStream>;
@@ -0,0 +1,220 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/word_sort.h"
+#include "include/thread_pool.h"
+
+// Standard includes
+#include <algorithm> // for sort, copy and inplace_merge
+#include <cstdint>
+#include <thread>
+
+void build_sort_keys(WordTable& words, Collation::Mode mode, size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = ThreadPool::get_default_thread_count();
+    }
+    if (words.size() < PARALLEL_SORT_THRESHOLD) {
+        thread_count = 1;
+    }
+
+    // Each thread keys a slice of the table into a pool of its own, the slices are joined in order afterwards
+    std::vector<std::string> chars(thread_count);
+    std::vector<std::vector<uint32_t>> ends(thread_count);
+    auto build_slice = [&words, &chars, &ends, mode, thread_count](size_t t) {
+        size_t begin = words.size() * t / thread_count;
+        size_t end = words.size() * (t + 1) / thread_count;
+        ends[t].reserve(end - begin);
+        for (size_t w_i = begin; w_i < end; w_i++) {
+            chars[t] += Collation::get_sort_key(words.get_name(w_i), mode);
+            ends[t].push_back(chars[t].size());
+        }
+    };
+
+    if (thread_count == 1) {
+        build_slice(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back(build_slice, t);
+        }
+        for (std::thread& th : threads) {
+            th.join();
+        }
+    }
+
+    std::string all_chars = std::move(chars[0]);
+    std::vector<uint32_t> offsets{0};
+    offsets.reserve(words.size() + 1);
+    offsets.insert(offsets.end(), ends[0].begin(), ends[0].end());
+    for (size_t t = 1; t < thread_count; t++) {
+        uint32_t base = all_chars.size();
+        all_chars += chars[t];
+        for (uint32_t e : ends[t]) {
+            offsets.push_back(base + e);
+        }
+    }
+    words.set_sort_keys(std::move(all_chars), std::move(offsets));
+}
+
+namespace {
+
+// Ties are broken by position, which makes the order total and so the same whichever way it's sorted
+bool key_less(const std::vector<std::string_view>& keys, size_t a, size_t b) {
+    int c = keys[a].compare(keys[b]);
+    if (c != 0) {
+        return c < 0;
+    }
+    return a < b;
+}
+
+// Sorts order[begin, end) with the backend that suits its size
+void sort_range(const std::vector<std::string_view>& keys, std::vector<size_t>& order, size_t begin, size_t end) {
+    if (end - begin >= RADIX_SORT_THRESHOLD) {
+        radix_sort_indices(keys, order, begin, end);
+    } else {
+        comparison_sort_indices(keys, order, begin, end);
+    }
+}
+
+} // namespace
+
+void comparison_sort_indices(const std::vector<std::string_view>& keys, std::vector<size_t>& order, size_t begin, size_t end) {
+    std::sort(order.begin() + begin, order.begin() + end, [&keys](size_t a, size_t b) {
+        return key_less(keys, a, b);
+    });
+}
+
+void radix_sort_indices(const std::vector<std::string_view>& keys, std::vector<size_t>& order, size_t begin, size_t end) {
+    // MSD radix sort on the key bytes. Every pass is a stable counting sort, so words with equal keys
+    // stay in their incoming order, which is ascending position for ranges that start out unsorted.
+    // Bucket 0 holds keys that end at the current depth, bytes go to buckets 1 to 256.
+    struct Range {
+        size_t begin;
+        size_t end;
+        size_t depth;
+    };
+
+    std::vector<size_t> tmp(end - begin);
+    std::vector<uint16_t> digits(end - begin);
+    std::vector<Range> stack;
+    stack.push_back({begin, end, 0});
+
+    while (!stack.empty()) {
+        Range r = stack.back();
+        stack.pop_back();
+
+        if (r.end - r.begin < RADIX_SORT_CUTOFF) {
+            std::sort(order.begin() + r.begin, order.begin() + r.end, [&keys](size_t a, size_t b) {
+                return key_less(keys, a, b);
+            });
+            continue;
+        }
+
+        // Read each key byte once, the counting and scattering passes then only touch the small digits array
+        size_t counts[257] = {0};
+        for (size_t i = r.begin; i < r.end; i++) {
+            std::string_view key = keys[order[i]];
+            uint16_t d = (r.depth < key.size()) ? static_cast<unsigned char>(key[r.depth]) + 1 : 0;
+            digits[i - begin] = d;
+            counts[d]++;
+        }
+
+        size_t starts[257];
+        size_t pos = 0;
+        for (size_t b = 0; b < 257; b++) {
+            starts[b] = pos;
+            pos += counts[b];
+        }
+
+        for (size_t i = r.begin; i < r.end; i++) {
+            tmp[starts[digits[i - begin]]++] = order[i];
+        }
+        std::copy(tmp.begin(), tmp.begin() + (r.end - r.begin), order.begin() + r.begin);
+
+        // Keys in bucket 0 are all equal (they ended here), the others continue on the next byte
+        size_t bucket_begin = r.begin + counts[0];
+        for (size_t b = 1; b < 257; b++) {
+            size_t bucket_end = bucket_begin + counts[b];
+            if (counts[b] > 1) {
+                stack.push_back({bucket_begin, bucket_end, r.depth + 1});
+            }
+            bucket_begin = bucket_end;
+        }
+    }
+}
+
+std::vector<size_t> sort_word_indices(const std::vector<std::string_view>& keys, size_t thread_count) {
+    std::vector<size_t> order(keys.size());
+    for (size_t w_i = 0; w_i < keys.size(); w_i++) {
+        order[w_i] = w_i;
+    }
+
+    if (thread_count == 0) {
+        thread_count = ThreadPool::get_default_thread_count();
+    }
+
+    if ((keys.size() < PARALLEL_SORT_THRESHOLD) || (thread_count <= 1)) {
+        sort_range(keys, order, 0, order.size());
+        return order;
+    }
+
+    // Parallel merge sort: sort one run per thread, then merge neighbouring runs pairwise,
+    // halving the number of runs (and threads) each round
+    std::vector<size_t> bounds;
+    for (size_t t = 0; t <= thread_count; t++) {
+        bounds.push_back(order.size() * t / thread_count);
+    }
+
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back([&keys, &order, &bounds, t] {
+                sort_range(keys, order, bounds[t], bounds[t + 1]);
+            });
+        }
+        for (std::thread& th : threads) {
+            th.join();
+        }
+    }
+
+    auto less = [&keys](size_t a, size_t b) {
+        return key_less(keys, a, b);
+    };
+
+    while (bounds.size() > 2) {
+        std::vector<size_t> next_bounds;
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r + 2 < bounds.size(); r += 2) {
+            size_t begin = bounds[r];
+            size_t mid = bounds[r + 1];
+            size_t end = bounds[r + 2];
+            threads.emplace_back([&order, &less, begin, mid, end] {
+                std::inplace_merge(order.begin() + begin, order.begin() + mid, order.begin() + end, less);
+            });
+            next_bounds.push_back(begin);
+        }
+
+        // An odd run out stays as it is for the next round
+        if (bounds.size() % 2 == 0) {
+            next_bounds.push_back(bounds[bounds.size() - 2]);
+        }
+        next_bounds.push_back(bounds.back());
+
+        for (std::thread& th : threads) {
+            th.join();
+        }
+        bounds = next_bounds;
+    }
+
+    return order;
+}
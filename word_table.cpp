@@ -0,0 +1,295 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/word_table.h"
+#include "include/hash.h"
+
+// Standard includes
+#include <limits>
+#include <stdexcept>
+#include <utility> // for move
+
+// Strings up to this size are interned, longer ones (sentences, notes) rarely repeat
+const size_t INTERN_MAX_SIZE = 64;
+
+// Initial number of intern slots, doubled whenever they are half full
+const size_t INTERN_INITIAL_SLOTS = 64;
+
+// List
+
+WordTable::List::List(const char* pool, const StringRef* refs, size_t count) : pool(pool), refs(refs), count(count) {}
+
+size_t WordTable::List::size() const {
+    return count;
+}
+
+bool WordTable::List::empty() const {
+    return count == 0;
+}
+
+std::string_view WordTable::List::operator[](size_t i) const {
+    return std::string_view(pool + refs[i].offset, refs[i].size);
+}
+
+std::string_view WordTable::List::at(size_t i) const {
+    if (i >= count) {
+        throw std::out_of_range("WordTable::List::at");
+    }
+    return (*this)[i];
+}
+
+// ExtraFields
+
+WordTable::ExtraFields::ExtraFields(const char* pool, const StringRef* entries, const ExtraRange* ranges, size_t count) :
+    pool(pool), entries(entries), ranges(ranges), count(count) {}
+
+size_t WordTable::ExtraFields::size() const {
+    return count;
+}
+
+std::string_view WordTable::ExtraFields::get_key(size_t i) const {
+    return std::string_view(pool + ranges[i].key.offset, ranges[i].key.size);
+}
+
+WordTable::List WordTable::ExtraFields::get(size_t i) const {
+    return List(pool, entries + ranges[i].begin, ranges[i].end - ranges[i].begin);
+}
+
+WordTable::List WordTable::ExtraFields::find(std::string_view key) const {
+    for (size_t i = 0; i < count; i++) {
+        if (get_key(i) == key) {
+            return get(i);
+        }
+    }
+    return List(pool, entries, 0);
+}
+
+// WordView
+
+const WordTable::List& WordTable::WordView::get_list(ListField f) const {
+    switch (f) {
+        case ETYMOLOGY:
+            return etymology;
+        case EXAMPLES:
+            return examples;
+        case EXAMPLE_SENTENCES:
+            return example_sentences;
+        case INSPIRATIONS:
+            return inspirations;
+        default:
+            return notes;
+    }
+}
+
+// Methods
+
+uint32_t WordTable::add(const Word& w) {
+    own_pool();
+    names.push_back(add_string(w.name));
+    definitions.push_back(add_string(w.definition));
+    for (const std::vector<std::string>* field : {&w.etymology, &w.examples, &w.example_sentences, &w.inspirations, &w.notes}) {
+        for (const std::string& s : *field) {
+            push_list_entry(s);
+        }
+        list_begins.push_back(list_entries.size());
+    }
+    for (const Word::ExtraField& f : w.extra_fields) {
+        uint32_t begin = list_entries.size();
+        for (const std::string& s : f.entries) {
+            push_list_entry(s);
+        }
+        push_extra_range(f.key, begin);
+    }
+    return finish_word();
+}
+
+uint32_t WordTable::add(const WordView& w) {
+    own_pool();
+    names.push_back(add_string(w.name));
+    definitions.push_back(add_string(w.definition));
+    for (const List* field : {&w.etymology, &w.examples, &w.example_sentences, &w.inspirations, &w.notes}) {
+        for (size_t i = 0; i < field->size(); i++) {
+            push_list_entry((*field)[i]);
+        }
+        list_begins.push_back(list_entries.size());
+    }
+    for (size_t f_i = 0; f_i < w.extra_fields.size(); f_i++) {
+        uint32_t begin = list_entries.size();
+        List entries = w.extra_fields.get(f_i);
+        for (size_t i = 0; i < entries.size(); i++) {
+            push_list_entry(entries[i]);
+        }
+        push_extra_range(w.extra_fields.get_key(f_i), begin);
+    }
+    return finish_word();
+}
+
+uint32_t WordTable::add(const WordRefs& w) {
+    if (list_entries.size() + w.entries.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many list entries");
+    }
+
+    names.push_back(w.name);
+    definitions.push_back(w.definition);
+    uint32_t base = list_entries.size();
+    list_entries.insert(list_entries.end(), w.entries.begin(), w.entries.end());
+    for (uint32_t end : w.list_ends) {
+        list_begins.push_back(base + end);
+    }
+    for (ExtraRange r : w.extra_fields) {
+        r.begin += base;
+        r.end += base;
+        extra_ranges.push_back(r);
+    }
+    return finish_word();
+}
+
+void WordTable::reserve_pool(size_t size) {
+    pool.reserve(size);
+}
+
+void WordTable::use_pool(std::shared_ptr<const void> owner, std::string_view text) {
+    outside_pool = text;
+    outside_pool_owner = std::move(owner);
+}
+
+size_t WordTable::size() const {
+    return names.size();
+}
+
+WordTable::WordView WordTable::get(uint32_t id) const {
+    return WordView{
+        get_string(names[id]),
+        get_string(definitions[id]),
+        get_list(id, ETYMOLOGY),
+        get_list(id, EXAMPLES),
+        get_list(id, EXAMPLE_SENTENCES),
+        get_list(id, INSPIRATIONS),
+        get_list(id, NOTES),
+        ExtraFields(pool_data(), list_entries.data(), extra_ranges.data() + extra_begins[id], extra_begins[id + 1] - extra_begins[id])
+    };
+}
+
+std::string_view WordTable::get_name(uint32_t id) const {
+    return get_string(names[id]);
+}
+
+void WordTable::set_sort_keys(std::string chars, std::vector<uint32_t> offsets) {
+    sort_key_chars = std::move(chars);
+    sort_key_offsets = std::move(offsets);
+}
+
+std::string_view WordTable::get_sort_key(uint32_t id) const {
+    return std::string_view(sort_key_chars.data() + sort_key_offsets[id], sort_key_offsets[id + 1] - sort_key_offsets[id]);
+}
+
+// Helpers
+
+WordTable::StringRef WordTable::add_string(std::string_view s) {
+    if (s.empty()) {
+        return StringRef();
+    }
+    if (pool.size() + s.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Dictionary text over 4 GiB");
+    }
+
+    StringRef r;
+    r.offset = static_cast<uint32_t>(pool.size());
+    r.size = static_cast<uint32_t>(s.size());
+    if (s.size() > INTERN_MAX_SIZE) {
+        pool.append(s);
+        return r;
+    }
+
+    if ((interned_count + 1) * 2 > intern_slots.size()) {
+        grow_intern_slots();
+    }
+
+    size_t mask = intern_slots.size() - 1;
+    for (size_t slot = fnv1a(s.data(), s.size()) & mask;; slot = (slot + 1) & mask) {
+        StringRef& candidate = intern_slots[slot];
+        if (candidate.size == 0) {
+            pool.append(s);
+            candidate = r;
+            interned_count++;
+            return r;
+        }
+        if (get_string(candidate) == s) {
+            return candidate;
+        }
+    }
+}
+
+void WordTable::push_list_entry(std::string_view s) {
+    list_entries.push_back(add_string(s));
+    if (list_entries.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many list entries");
+    }
+}
+
+void WordTable::push_extra_range(std::string_view key, uint32_t begin) {
+    ExtraRange r;
+    r.key = add_string(key);
+    r.begin = begin;
+    r.end = list_entries.size();
+    extra_ranges.push_back(r);
+}
+
+uint32_t WordTable::finish_word() {
+    list_begins.push_back(list_entries.size());
+    extra_begins.push_back(extra_ranges.size());
+
+    // Keys set before this word no longer cover the table
+    sort_key_offsets.clear();
+    sort_key_chars.clear();
+    return static_cast<uint32_t>(names.size() - 1);
+}
+
+void WordTable::own_pool() {
+    if (outside_pool_owner) {
+        pool.assign(outside_pool);
+        outside_pool = std::string_view();
+        outside_pool_owner.reset();
+    }
+}
+
+const char* WordTable::pool_data() const {
+    return outside_pool_owner ? outside_pool.data() : pool.data();
+}
+
+void WordTable::grow_intern_slots() {
+    std::vector<StringRef> old = std::move(intern_slots);
+    intern_slots.assign(old.empty() ? INTERN_INITIAL_SLOTS : old.size() * 2, StringRef());
+
+    size_t mask = intern_slots.size() - 1;
+    for (const StringRef& r : old) {
+        if (r.size == 0) {
+            continue;
+        }
+        std::string_view s = get_string(r);
+        size_t slot = fnv1a(s.data(), s.size()) & mask;
+        while (intern_slots[slot].size != 0) {
+            slot = (slot + 1) & mask;
+        }
+        intern_slots[slot] = r;
+    }
+}
+
+std::string_view WordTable::get_string(StringRef r) const {
+    return std::string_view(pool_data() + r.offset, r.size);
+}
+
+WordTable::List WordTable::get_list(uint32_t id, ListField f) const {
+    size_t i = static_cast<size_t>(id) * (LIST_FIELD_COUNT + 1) + f;
+    return List(pool_data(), list_entries.data() + list_begins[i], list_begins[i + 1] - list_begins[i]);
+}
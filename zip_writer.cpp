@@ -0,0 +1,230 @@
+/*
+This file is part of Adict.
+
+Adict is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+Adict is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with Adict. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Program includes
+#include "include/zip_writer.h"
+
+// Standard includes
+#include <algorithm> // for min
+#include <cstdio> // for rename and remove
+#include <cstring> // for memset
+#include <limits>
+#include <stdexcept>
+
+// Compressed bytes gathered before they are written to the file
+const size_t ZIP_OUT_BUFFER_SIZE = 1 << 16;
+
+// Record signatures and fields, see the PKWARE APPNOTE
+const uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+const uint32_t ZIP_DATA_DESCRIPTOR = 0x08074b50;
+const uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+const uint32_t ZIP_END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+const uint16_t ZIP_VERSION = 20; // 2.0, deflate
+const uint16_t ZIP_FLAGS = 0x0808; // sizes in a data descriptor, UTF-8 names
+const uint16_t ZIP_METHOD_DEFLATE = 8;
+const uint16_t ZIP_DOS_TIME = 0;
+const uint16_t ZIP_DOS_DATE = (1 << 5) | 1; // 1980-01-01, the output doesn't depend on the clock
+
+// Methods
+
+ZipWriter::ZipWriter(const std::string& fpath) :
+    path(fpath), tmp_path(fpath + ".tmp"), f(tmp_path, std::ios::binary | std::ios::trunc), out_buf(ZIP_OUT_BUFFER_SIZE) {
+    std::memset(&zs, 0, sizeof(zs));
+}
+
+ZipWriter::~ZipWriter() {
+    if (entry_open) {
+        deflateEnd(&zs);
+    }
+    if (!closed) {
+        f.close();
+        std::remove(tmp_path.c_str());
+    }
+}
+
+bool ZipWriter::is_open() const {
+    return f.is_open();
+}
+
+void ZipWriter::begin_entry(const std::string& name) {
+    if (entry_open) {
+        end_entry();
+    }
+
+    Entry e;
+    e.name = name;
+    e.offset = get_offset();
+    entries.push_back(e);
+
+    put_u32(ZIP_LOCAL_HEADER);
+    put_u16(ZIP_VERSION);
+    put_u16(ZIP_FLAGS);
+    put_u16(ZIP_METHOD_DEFLATE);
+    put_u16(ZIP_DOS_TIME);
+    put_u16(ZIP_DOS_DATE);
+    put_u32(0); // crc, sizes: in the data descriptor
+    put_u32(0);
+    put_u32(0);
+    put_u16(static_cast<uint16_t>(name.size()));
+    put_u16(0); // extra field length
+    put_bytes(name.data(), name.size());
+
+    // Raw deflate, the zip headers replace the zlib wrapper
+    std::memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Could not start compressing " + name);
+    }
+    entry_open = true;
+    crc = crc32(0, Z_NULL, 0);
+    size = 0;
+    compressed_size = 0;
+}
+
+void ZipWriter::write(const char* data, size_t n) {
+    // zlib takes at most a uInt at a time
+    while (n > 0) {
+        uInt part = static_cast<uInt>(std::min<size_t>(n, std::numeric_limits<uInt>::max()));
+        crc = crc32(static_cast<uLong>(crc), reinterpret_cast<const Bytef*>(data), part);
+        size += part;
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = part;
+        deflate_input(Z_NO_FLUSH);
+        data += part;
+        n -= part;
+    }
+}
+
+void ZipWriter::write(const std::string& s) {
+    write(s.data(), s.size());
+}
+
+void ZipWriter::end_entry() {
+    if (!entry_open) {
+        return;
+    }
+
+    zs.next_in = nullptr;
+    zs.avail_in = 0;
+    deflate_input(Z_FINISH);
+    deflateEnd(&zs);
+    entry_open = false;
+
+    if ((size > std::numeric_limits<uint32_t>::max()) || (compressed_size > std::numeric_limits<uint32_t>::max())) {
+        throw std::runtime_error("Zip entry too large: " + entries.back().name);
+    }
+
+    Entry& e = entries.back();
+    e.crc = static_cast<uint32_t>(crc);
+    e.size = static_cast<uint32_t>(size);
+    e.compressed_size = static_cast<uint32_t>(compressed_size);
+
+    put_u32(ZIP_DATA_DESCRIPTOR);
+    put_u32(e.crc);
+    put_u32(e.compressed_size);
+    put_u32(e.size);
+}
+
+void ZipWriter::close() {
+    if (closed) {
+        return;
+    }
+    end_entry();
+
+    uint32_t directory_offset = get_offset();
+    for (const Entry& e : entries) {
+        put_u32(ZIP_CENTRAL_HEADER);
+        put_u16(ZIP_VERSION); // made by
+        put_u16(ZIP_VERSION); // needed
+        put_u16(ZIP_FLAGS);
+        put_u16(ZIP_METHOD_DEFLATE);
+        put_u16(ZIP_DOS_TIME);
+        put_u16(ZIP_DOS_DATE);
+        put_u32(e.crc);
+        put_u32(e.compressed_size);
+        put_u32(e.size);
+        put_u16(static_cast<uint16_t>(e.name.size()));
+        put_u16(0); // extra field length
+        put_u16(0); // comment length
+        put_u16(0); // disk number
+        put_u16(0); // internal attributes
+        put_u32(0); // external attributes
+        put_u32(e.offset);
+        put_bytes(e.name.data(), e.name.size());
+    }
+    uint32_t directory_size = get_offset() - directory_offset;
+
+    put_u32(ZIP_END_OF_CENTRAL_DIRECTORY);
+    put_u16(0); // this disk
+    put_u16(0); // disk with the directory
+    put_u16(static_cast<uint16_t>(entries.size()));
+    put_u16(static_cast<uint16_t>(entries.size()));
+    put_u32(directory_size);
+    put_u32(directory_offset);
+    put_u16(0); // comment length
+
+    f.close();
+    if (!f) {
+        throw std::runtime_error("Could not write the zip file"); // the destructor removes it
+    }
+    closed = true;
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Could not move the zip file to " + path);
+    }
+}
+
+// Helpers
+
+void ZipWriter::deflate_input(int flush) {
+    while (true) {
+        zs.next_out = out_buf.data();
+        zs.avail_out = static_cast<uInt>(out_buf.size());
+        int ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_ERROR) {
+            throw std::runtime_error("Could not compress " + entries.back().name);
+        }
+
+        size_t produced = out_buf.size() - zs.avail_out;
+        put_bytes(out_buf.data(), produced);
+        compressed_size += produced;
+
+        // Done once deflate stops filling the whole buffer (and, when finishing, once the stream has ended)
+        if ((flush == Z_FINISH) ? (ret == Z_STREAM_END) : (zs.avail_out != 0)) {
+            return;
+        }
+    }
+}
+
+uint32_t ZipWriter::get_offset() {
+    std::streamoff offset = f.tellp();
+    if ((offset < 0) || (static_cast<uint64_t>(offset) > std::numeric_limits<uint32_t>::max())) {
+        throw std::runtime_error("Zip file too large");
+    }
+    return static_cast<uint32_t>(offset);
+}
+
+void ZipWriter::put_u16(uint16_t v) {
+    unsigned char b[2] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8)};
+    put_bytes(b, sizeof(b));
+}
+
+void ZipWriter::put_u32(uint32_t v) {
+    unsigned char b[4] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8), static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24)};
+    put_bytes(b, sizeof(b));
+}
+
+void ZipWriter::put_bytes(const void* data, size_t n) {
+    f.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+    if (!f) {
+        throw std::runtime_error("Could not write the zip file");
+    }
+}